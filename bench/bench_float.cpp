@@ -0,0 +1,79 @@
+/*
+    struc, A C++11 implementation of python's struct module.
+
+    struc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright (c) 2018, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+
+// Packs and unpacks big endian floating point records on a growing number
+// of threads. Throughput per thread should stay flat as threads are added,
+// since nothing is shared between the threads.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "struc.hpp"
+
+namespace
+{
+double run(const struc& s, size_t records)
+{
+   std::vector<char> buffer(s.calcsize());
+   double sum = 0;
+   for (size_t k = 0; k < records; ++k)
+   {
+      double a = static_cast<double>(k), c;
+      float b = static_cast<float>(k), e;
+      s.pack(buffer.data(), a, b, a);
+      s.unpack(buffer.data(), c, e, a);
+      sum += c + e + a;
+   }
+   return sum;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+   size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+   size_t max_threads = std::max(std::thread::hardware_concurrency(), 1U);
+   struc s(">dfd");
+   std::printf("%8s %16s %16s\n", "threads", "records/s", "per thread");
+   for (size_t threads = 1; threads <= max_threads; threads *= 2)
+   {
+      std::vector<double> sums(threads);
+      std::vector<std::thread> pool;
+      auto start = std::chrono::steady_clock::now();
+      for (size_t t = 0; t < threads; ++t)
+      {
+         pool.emplace_back([&, t]() { sums[t] = run(s, records); });
+      }
+      for (auto& t : pool)
+      {
+         t.join();
+      }
+      std::chrono::duration<double> elapsed =
+         std::chrono::steady_clock::now() - start;
+      double rate = static_cast<double>(threads * records) / elapsed.count();
+      std::printf("%8zu %16.0f %16.0f\n",
+                  threads,
+                  rate,
+                  rate / static_cast<double>(threads));
+   }
+   return 0;
+}
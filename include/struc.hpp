@@ -19,22 +19,75 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <boost/config.hpp>
 #include <boost/endian/arithmetic.hpp>
+#include <boost/endian/conversion.hpp>
+#include <cerrno>
 #include <cmath>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
-#include <sstream>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+#ifdef BOOST_NO_EXCEPTIONS
+#define STRUC_THROW(e) ((void)(e), std::abort())
+#else
+#define STRUC_THROW(e) throw e
+#endif
+
+// Vectorized byte swapping of arrays, define STRUC_NO_SIMD to disable
+#if !defined(STRUC_NO_SIMD) && defined(__GNUC__)                              \
+   && (defined(__x86_64__) || defined(__i386__))
+#define STRUC_X86_SIMD
+#define STRUC_TARGET(t) __attribute__((target(t)))
+#include <immintrin.h>
+#endif
+
+// Whether floats are stored in the byte order of integers, the IEEE fast
+// paths copy and swap them like integers and are disabled otherwise
+#if defined(__FLOAT_WORD_ORDER__) && defined(__BYTE_ORDER__)
+#define STRUC_FLOAT_INTEGER_ORDER (__FLOAT_WORD_ORDER__ == __BYTE_ORDER__)
+#else
+#define STRUC_FLOAT_INTEGER_ORDER 1
+#endif
+
+// Memory mapped files, define STRUC_NO_POSIX to disable
+#if !defined(STRUC_NO_POSIX) && (defined(__unix__) || defined(__APPLE__))
+#define STRUC_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 //! @brief Class mimicing python's pack module
 class struc
 {
 public:
    //! @brief Constructor
+   //!
+   //! Throws std::logic_error for illegal types, and for P without native
+   //! byte order.
    explicit struc(const std::string& pattern);
 
    //! @brief Like python's struct.pack
@@ -64,13 +117,508 @@ public:
                       std::tuple<T...>& t);
    //! @}
 
+   //! @brief Like python's struct.pack_into, returns the offset after the
+   //! packed record
+   //! @{
+   template <typename... T>
+   size_t pack_into(char* buffer,
+                    size_t length,
+                    size_t offset,
+                    const T&... t) const;
+   template <typename... T>
+   size_t pack_into(char* buffer,
+                    size_t length,
+                    size_t offset,
+                    const std::tuple<T...>& t) const;
+   template <typename... T>
+   static size_t pack_into(const std::string& pattern,
+                           char* buffer,
+                           size_t length,
+                           size_t offset,
+                           const T&... t);
+   template <typename... T>
+   static size_t pack_into(const std::string& pattern,
+                           char* buffer,
+                           size_t length,
+                           size_t offset,
+                           const std::tuple<T...>& t);
+   //! @}
+
+   //! @brief Like python's struct.unpack_from, returns the offset after the
+   //! unpacked record
+   //! @{
+   template <typename... T>
+   size_t unpack_from(const char* buffer,
+                      size_t length,
+                      size_t offset,
+                      T&... t) const;
+   template <typename... T>
+   size_t unpack_from(const char* buffer,
+                      size_t length,
+                      size_t offset,
+                      std::tuple<T...>& t) const;
+   template <typename... T>
+   static size_t unpack_from(const std::string& pattern,
+                             const char* buffer,
+                             size_t length,
+                             size_t offset,
+                             T&... t);
+   template <typename... T>
+   static size_t unpack_from(const std::string& pattern,
+                             const char* buffer,
+                             size_t length,
+                             size_t offset,
+                             std::tuple<T...>& t);
+   //! @}
+
    //! @brief Like python's struct.calcsize
    //! @{
    size_t calcsize() const;
    static size_t calcsize(const std::string& pattern);
    //! @}
 
+   //! @brief Distance between back-to-back records
+   //!
+   //! With native alignment this is calcsize() rounded up to the largest
+   //! alignment of the pattern's items, like the size of a C struct.
+   //! Otherwise it is calcsize().
+   size_t stride() const;
+
+   //! @brief Pack a range of records back-to-back, stride() bytes apart
+   //!
+   //! Each element is packed like the arguments to pack, so tuples are
+   //! expanded. f maps an element to what is packed, e.g. a std::tie of the
+   //! members of a struct. Padding bytes are left untouched. Returns the
+   //! number of bytes used, the number of elements times stride().
+   //!
+   //! The vector overloads allocate once for forward iterators, and grow
+   //! the vector record by record for input iterators, which can only be
+   //! walked once. Their padding bytes are zero.
+   //! @{
+   template <typename It>
+   size_t pack_many(char* buffer, It first, It last) const;
+   template <typename It, typename F>
+   size_t pack_many(char* buffer, It first, It last, F f) const;
+   template <typename It>
+   std::vector<char> pack_many(It first, It last) const;
+   template <typename It, typename F>
+   std::vector<char> pack_many(It first, It last, F f) const;
+   template <typename It>
+   static std::vector<char> pack_many(const std::string& pattern,
+                                      It first,
+                                      It last);
+   template <typename It, typename F>
+   static std::vector<char> pack_many(const std::string& pattern,
+                                      It first,
+                                      It last,
+                                      F f);
+   //! @}
+
+   //! @brief Unpack n back-to-back records, stride() bytes apart, into the
+   //! elements starting at out, each like the arguments to unpack
+   template <typename It>
+   void unpack_many(const char* buffer, size_t n, It out) const;
+
+   //! @brief Unpack n back-to-back records into one column per item
+   //!
+   //! Records are stride() bytes apart. A column is a pointer to n elements
+   //! or a std::vector, which is resized to n. Items are numbered like the
+   //! arguments to unpack, with arrays counting as one item per element.
+   template <typename... T>
+   void unpack_columns(const char* buffer, size_t n, T&&... columns) const;
+
+   //! @brief Pack n back-to-back records from one column per item, the
+   //! reverse of unpack_columns
+   //!
+   //! A column is a pointer to n elements or a std::vector of at least n
+   //! elements. Padding bytes are left untouched.
+   template <typename... T>
+   void pack_columns(char* buffer, size_t n, const T&... columns) const;
+
+   //! @brief Comparisons of scan conditions
+   enum class compare
+   {
+      eq,
+      ne,
+      lt,
+      le,
+      gt,
+      ge,
+   };
+
+   //! @brief Comparison of an item with a value, see where
+   template <typename T>
+   struct condition
+   {
+      size_t index;
+      compare op;
+      T value;
+   };
+
+   //! @brief Condition that item index compares as op to value, the item
+   //! being decoded as T
+   template <typename T>
+   static condition<T> where(size_t index, compare op, const T& value);
+
+   //! @brief Indices of the records that satisfy all conditions, among n
+   //! back-to-back records stride() bytes apart
+   //!
+   //! Only the items named by conditions are decoded, a block of records at
+   //! a time, with the comparisons done in tight loops over each block.
+   template <typename... T>
+   std::vector<size_t> scan(const char* buffer,
+                            size_t n,
+                            const condition<T>&... conditions) const;
+
+   //! @brief Indices of the records for which predicate(view) is true
+   //!
+   //! The predicate gets a view of each record, so only the items it reads
+   //! are decoded.
+   template <typename P>
+   std::vector<size_t> scan_if(const char* buffer, size_t n, P predicate) const;
+
+   //! @brief Sorts n back-to-back records, stride() bytes apart, in place
+   //! by item index
+   //!
+   //! The sort is a stable radix sort on the raw bytes of the key, which are
+   //! mapped so that signed and floating point items order by value in any
+   //! byte order. While sorting, the extra memory is the key and two 32 bit
+   //! indices per record, 16 bytes for 8 byte keys. The keys are freed, and
+   //! records are permuted in place one cycle at a time with only one index
+   //! per record. Beyond 2^32 records, the indices are 64 bit.
+   void sort_records(char* buffer, size_t n, size_t index) const;
+
+   //! @brief Order of n back-to-back records by item index, the records
+   //! themselves are left as they are
+   std::vector<size_t> sort_index(const char* buffer,
+                                  size_t n,
+                                  size_t index) const;
+
+   //! @brief Count, sum, minimum and maximum of an item over records
+   //!
+   //! The sum is kept in long long, unsigned long long or a floating point
+   //! type of at least double's precision, so that it does not overflow the
+   //! type the items are decoded as.
+   template <typename T>
+   struct summary
+   {
+      typedef typename std::conditional<
+         std::is_floating_point<T>::value,
+         typename std::common_type<T, double>::type,
+         typename std::conditional<std::is_signed<T>::value,
+                                   long long,
+                                   unsigned long long>::type>::type sum_type;
+
+      size_t count;
+      sum_type sum;
+      T min;
+      T max;
+
+      //! @brief sum / count, NaN if there are no records
+      double mean() const;
+   };
+
+   //! @brief Aggregates of item index over n back-to-back records, stride()
+   //! bytes apart, with the item decoded as T
+   //!
+   //! Items are decoded a block of records at a time through the column
+   //! kernels, so no tuples are materialized, and each aggregate is a tight
+   //! loop over a block. With no records, min and max are the largest and
+   //! lowest values of T.
+   //! @{
+   template <typename T>
+   summary<T> summarize(const char* buffer, size_t n, size_t index) const;
+   template <typename T, typename P>
+   size_t count_if(const char* buffer,
+                   size_t n,
+                   size_t index,
+                   P predicate) const;
+   //! @}
+
+   //! @brief Histogram of item index with buckets of equal width between
+   //! low and high, items outside [low, high) are not counted
+   //!
+   //! Throws std::invalid_argument if there are no buckets or high is not
+   //! above low.
+   template <typename T>
+   std::vector<size_t> histogram(const char* buffer,
+                                 size_t n,
+                                 size_t index,
+                                 double low,
+                                 double high,
+                                 size_t buckets) const;
+
+   //! @brief Parallel versions of summarize, count_if and histogram, see
+   //! pack_many_parallel
+   //! @{
+   template <typename T, typename E>
+   summary<T> summarize_parallel(E executor,
+                                 const char* buffer,
+                                 size_t n,
+                                 size_t index) const;
+   template <typename T, typename E, typename P>
+   size_t count_if_parallel(E executor,
+                            const char* buffer,
+                            size_t n,
+                            size_t index,
+                            P predicate) const;
+   template <typename T, typename E>
+   std::vector<size_t> histogram_parallel(E executor,
+                                          const char* buffer,
+                                          size_t n,
+                                          size_t index,
+                                          double low,
+                                          double high,
+                                          size_t buckets) const;
+   //! @}
+
+   //! @brief Parallel versions of pack_many, unpack_many, unpack_columns and
+   //! pack_columns
+   //!
+   //! The records are split into record aligned chunks, at most one per unit
+   //! of executor.concurrency(), and executor(chunks, task) must call
+   //! task(0) to task(chunks - 1) and return when all have finished, see
+   //! thread_executor. Iterators must be random access.
+   //! @{
+   template <typename E, typename It>
+   size_t pack_many_parallel(E executor,
+                             char* buffer,
+                             It first,
+                             It last) const;
+   template <typename E, typename It, typename F>
+   size_t pack_many_parallel(E executor,
+                             char* buffer,
+                             It first,
+                             It last,
+                             F f) const;
+   template <typename E, typename It>
+   void unpack_many_parallel(E executor,
+                             const char* buffer,
+                             size_t n,
+                             It out) const;
+   template <typename E, typename... T>
+   void unpack_columns_parallel(E executor,
+                                const char* buffer,
+                                size_t n,
+                                T&&... columns) const;
+   template <typename E, typename... T>
+   void pack_columns_parallel(E executor,
+                              char* buffer,
+                              size_t n,
+                              const T&... columns) const;
+   //! @}
+
+   //! @brief Pack or unpack a single item in place
+   //!
+   //! Items are numbered like the arguments to pack and unpack, with arrays
+   //! counting as one item per element.
+   //! @{
+   template <typename T>
+   void pack_field(char* buffer, size_t index, const T& t) const;
+   template <typename T>
+   void unpack_field(const char* buffer, size_t index, T& t) const;
+   //! @}
+
+   //! @brief Error codes of the non-throwing API
+   enum class errc
+   {
+      extra_arguments = 1,
+      missing_arguments,
+      illegal_type,
+      expected_char_array,
+      wrong_string_length,
+      array_too_small,
+      array_too_large,
+      too_large_for_ieee,
+      frexp_out_of_range,
+      ieee_special_value,
+      buffer_too_small,
+      index_out_of_range,
+      partial_record,
+   };
+
+   //! @brief Outcome of the non-throwing API
+   struct status
+   {
+      //! @brief The error, errc() on success
+      errc code;
+      //! @brief Index of the item the error refers to
+      size_t index;
+      //! @brief Expected and actual count or length, where applicable
+      //! @{
+      size_t expected;
+      size_t actual;
+      //! @}
+
+      //! @brief The error as a std::error_code, false on success
+      std::error_code error() const;
+   };
+
+   //! @brief Error category of errc
+   static const std::error_category& category();
+
+   //! @brief Non-throwing constructor, s is the compiled pattern, or null if
+   //! the pattern has an illegal type
+   static status try_compile(const std::string& pattern,
+                             std::unique_ptr<struc>& s);
+
+   //! @brief Non-throwing versions of pack, unpack, pack_into, unpack_from,
+   //! pack_field and unpack_field
+   //!
+   //! These report failures in the returned status instead of throwing, and
+   //! can be used in builds without exceptions.
+   //! @{
+   template <typename... T>
+   status try_pack(char* buffer, const T&... t) const;
+   template <typename... T>
+   status try_pack(char* buffer, const std::tuple<T...>& t) const;
+   template <typename... T>
+   status try_unpack(const char* buffer, T&... t) const;
+   template <typename... T>
+   status try_unpack(const char* buffer, std::tuple<T...>& t) const;
+   template <typename... T>
+   status try_pack_into(char* buffer,
+                        size_t length,
+                        size_t offset,
+                        const T&... t) const;
+   template <typename... T>
+   status try_pack_into(char* buffer,
+                        size_t length,
+                        size_t offset,
+                        const std::tuple<T...>& t) const;
+   template <typename... T>
+   status try_unpack_from(const char* buffer,
+                          size_t length,
+                          size_t offset,
+                          T&... t) const;
+   template <typename... T>
+   status try_unpack_from(const char* buffer,
+                          size_t length,
+                          size_t offset,
+                          std::tuple<T...>& t) const;
+   template <typename T>
+   status try_pack_field(char* buffer, size_t index, const T& t) const;
+   template <typename T>
+   status try_unpack_field(const char* buffer, size_t index, T& t) const;
+   template <typename... T>
+   status try_unpack_columns(const char* buffer,
+                             size_t n,
+                             T&&... columns) const;
+   template <typename... T>
+   status try_pack_columns(char* buffer,
+                           size_t n,
+                           const T&... columns) const;
+   //! @}
+
+#ifdef STRUC_POSIX
+   //! @brief Like pack, but into a list of buffers for writev or sendmsg
+   //!
+   //! Items are packed into scratch, which must hold calcsize() bytes,
+   //! except for those given as std::string or char pointers. iov gets the
+   //! parts of scratch between such strings, and pointers to the strings
+   //! themselves in place of copies. The strings must outlive the writes.
+   //! @{
+   template <typename... T>
+   void pack_iov(std::vector<iovec>& iov, char* scratch, const T&... t) const;
+   template <typename... T>
+   status try_pack_iov(std::vector<iovec>& iov,
+                       char* scratch,
+                       const T&... t) const;
+   //! @}
+#endif
+
+   //! @brief Process wide cache of compiled patterns, used by the static
+   //! pack, unpack and calcsize overloads
+   class cache;
+
+   //! @brief Read only access to single items of a packed buffer
+   class view;
+
+   //! @brief Range of back-to-back records, see iter_unpack
+   template <typename V>
+   class records;
+
+   //! @brief Pointer and length of contiguous elements, see make_span
+   template <typename T>
+   class span;
+
+   //! @brief Elements to pack a run of items from or unpack it into
+   //!
+   //! Like C arrays, std::array and std::vector, a span provides the items
+   //! of a run such as 100i. It must have as many elements as the run has
+   //! items, except that a std::vector is resized by unpack.
+   template <typename T>
+   static span<T> make_span(T* data, size_t size);
+
+   //! @brief Runs the chunks of the parallel batch functions on threads
+   class thread_executor;
+
+   //! @brief Like python's struct.iter_unpack, a range of views of the
+   //! records in buffer
+   //!
+   //! Records are stride() bytes apart. The last record may lack its trailing
+   //! padding. The struc must outlive the range.
+   records<view> iter_unpack(const char* buffer, size_t length) const;
+
+#ifdef STRUC_POSIX
+   //! @brief Read only memory mapping of a file of records
+   class mapped_file;
+#endif
+
+   //! @brief Decodes a stream of back-to-back records read in large chunks
+   class reader;
+
+   //! @brief Decodes records from fragments of a stream as they arrive
+   class decoder;
+
+   //! @brief Splits a stream into frames of a header and a payload
+   class framer;
+
+#ifdef STRUC_POSIX
+   //! @brief Packs records into a large buffer written out in one go
+   class writer;
+
+   //! @brief Packs records into buffers written by a background thread
+   class async_writer;
+#endif
+
+   //! @brief Pattern parsed at compile time, see STRUC_FIXED
+   template <char... P>
+   class fixed;
+
+   //! @brief Character i of pattern, or '\0' beyond its end
+   template <size_t N>
+   static constexpr char pattern_at(const char (&pattern)[N], size_t i);
+
+   //! @brief Byte swaps n items in place
+   typedef void (*swap_function)(char* p, size_t n);
+
+   //! @brief The byte swap kernels this CPU supports, best first
+   //!
+   //! Each table holds the kernels for 2, 4 and 8 byte items at size / 4.
+   //! Runs use the first table, the last one is the portable scalar code.
+   static std::vector<const swap_function*> swap_kernel_tables();
+
 private:
+   class error_category;
+
+   struc(const std::string& pattern, status& st);
+
+   bool compile(const std::string& pattern, status& st, char& type);
+
+   static char pattern_too_long();
+
+   static bool fail(status& st,
+                    errc e,
+                    size_t expected = 0,
+                    size_t actual = 0);
+
+   [[noreturn]] static void raise(const char* what,
+                                  const status& st,
+                                  char type);
+
+   [[noreturn]] void raise(const char* what, const status& st) const;
+
    enum control
    {
       native,
@@ -97,21 +645,21 @@ private:
 
    template <typename S>
    static
-      typename std::enable_if<std::is_same<std::string, S>::value, void>::type
-      check_scalar(size_t num, const S& s);
+      typename std::enable_if<std::is_same<std::string, S>::value, bool>::type
+      check_scalar(size_t num, const S& s, status& st);
 
    template <typename S>
    static typename std::enable_if<std::is_constructible<std::string, S>::value
                                      && !std::is_null_pointer<S>::value
                                      && !std::is_same<std::string, S>::value,
-                                  void>::type
-      check_scalar(size_t num, const S& s);
+                                  bool>::type
+      check_scalar(size_t num, const S& s, status& st);
 
    template <typename S>
    static typename std::enable_if<!std::is_constructible<std::string, S>::value
                                      || std::is_null_pointer<S>::value,
-                                  void>::type
-      check_scalar(size_t num, const S& s);
+                                  bool>::type
+      check_scalar(size_t num, const S& s, status& st);
 
    template <typename S>
    static
@@ -139,11 +687,10 @@ private:
    static size_t native_alignment(char type);
 
    template <typename F>
-   static typename std::enable_if<std::is_same<F, float>::value, bool>::type
-      is_ieee();
-
-   template <typename F>
-   static typename std::enable_if<std::is_same<F, double>::value, bool>::type
+   static constexpr
+      typename std::enable_if<std::is_same<F, float>::value
+                                 || std::is_same<F, double>::value,
+                              bool>::type
       is_ieee();
 
    template <typename F>
@@ -152,63 +699,101 @@ private:
                                   bool>::type
       is_ieee();
 
-   template <typename F>
-   static typename std::enable_if<std::is_same<F, float>::value, void>::type
-      pack_non_ieee(bool litte_endian, char* buffer, size_t& offset, F f);
+   static bool needs_swap(control c);
+
+   static size_t run_size(control c, char type);
+
+   template <typename E>
+   static bool is_run(control c, char type);
+
+   static void swap_bytes(char* p, size_t n, size_t size);
+
+   static const swap_function* swap_kernels();
+
+   template <typename U>
+   static void swap_scalar(char* p, size_t n);
+
+#ifdef STRUC_X86_SIMD
+   template <typename U>
+   STRUC_TARGET("sse2") static void swap_sse2(char* p, size_t n);
+
+   template <typename U>
+   STRUC_TARGET("ssse3") static void swap_ssse3(char* p, size_t n);
+
+   template <typename U>
+   STRUC_TARGET("avx2") static void swap_avx2(char* p, size_t n);
+
+   template <typename U>
+   static void swap_mask(char (&mask)[16]);
+#endif
 
    template <typename F>
-   static typename std::enable_if<std::is_same<F, double>::value, void>::type
-      pack_non_ieee(bool litte_endian, char* buffer, size_t& offset, F f);
+   static typename std::enable_if<std::is_same<F, float>::value, bool>::type
+      pack_non_ieee(
+         bool litte_endian, char* buffer, size_t& offset, status& st, F f);
+
    template <typename F>
+   static typename std::enable_if<std::is_same<F, double>::value, bool>::type
+      pack_non_ieee(
+         bool litte_endian, char* buffer, size_t& offset, status& st, F f);
 
+   template <typename F>
    static typename std::enable_if<!std::is_same<F, float>::value
                                      && !std::is_same<F, double>::value,
-                                  void>::type
-      pack_non_ieee(bool litte_endian, char* buffer, size_t& offset, F f);
+                                  bool>::type
+      pack_non_ieee(
+         bool litte_endian, char* buffer, size_t& offset, status& st, F f);
 
    template <typename I, typename T, typename U = T>
    static typename std::enable_if<std::is_integral<T>::value, void>::type
       pack_native(char* buffer, size_t& offset, const I& i);
 
    template <typename F, typename T, typename U = T>
-   static typename std::enable_if<std::is_floating_point<T>::value, void>::type
-      pack_native(char* buffer, size_t& offset, const F& f);
+   static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+      pack_native(char* buffer, size_t& offset, status& st, const F& f);
 
    template <typename I, typename T, typename U = T>
    static typename std::enable_if<std::is_integral<T>::value, void>::type
       pack_non_native(control c, char* buffer, size_t& offset, const I& i);
 
    template <typename F, typename T, typename U = T>
-   static typename std::enable_if<std::is_floating_point<T>::value, void>::type
-      pack_non_native(control c, char* buffer, size_t& offset, const F& f);
+   static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+      pack_non_native(control c,
+                      char* buffer,
+                      size_t& offset,
+                      status& st,
+                      const F& f);
 
    template <typename I>
-   static typename std::enable_if<std::is_arithmetic<I>::value, void>::type
+   static typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
       pack_scalar(control c,
                   std::pair<size_t, char>& cur,
                   char* buffer,
                   size_t& offset,
+                  status& st,
                   const I& i);
 
    template <typename A>
    static typename std::enable_if<std::is_array<A>::value
                                      && !std::is_constructible<std::string,
                                                                A>::value,
-                                  void>::type
+                                  bool>::type
       pack_scalar(control c,
                   std::pair<size_t, char>& cur,
                   char* buffer,
                   size_t& offset,
+                  status& st,
                   const A& a);
 
    template <typename S>
    static typename std::enable_if<std::is_constructible<std::string, S>::value
                                      && !std::is_null_pointer<S>::value,
-                                  void>::type
+                                  bool>::type
       pack_scalar(control c,
                   std::pair<size_t, char>& cur,
                   char* buffer,
                   size_t& offset,
+                  status& st,
                   const S& s);
 
    template <typename P>
@@ -217,34 +802,135 @@ private:
                                && !std::is_constructible<std::string, P>::value)
                                  || std::is_null_pointer<P>::value
                                  || std::is_member_pointer<P>::value,
-                              void>::type
+                              bool>::type
       pack_scalar(control c,
                   std::pair<size_t, char>& cur,
                   char* buffer,
                   size_t& offset,
+                  status& st,
                   const P& p);
 
+   template <typename T, size_t N>
+   static bool pack_scalar(control c,
+                           std::pair<size_t, char>& cur,
+                           char* buffer,
+                           size_t& offset,
+                           status& st,
+                           const std::array<T, N>& a);
+
+   static const char* string_data(const std::string& s);
+   static const char* string_data(const char* s);
+   static size_t string_size(const std::string& s);
+   static size_t string_size(const char* s);
+   template <typename S>
+   static typename std::enable_if<!std::is_convertible<S, const char*>::value
+                                     && !std::is_same<S, std::string>::value,
+                                  size_t>::type
+      string_size(const S& s);
+
+   template <typename S>
+   static typename std::enable_if<
+      std::is_array<S>::value,
+      const typename std::remove_extent<S>::type*>::type
+      array_data(const S& s);
+   template <typename S>
+   static typename std::enable_if<!std::is_array<S>::value, const char*>::type
+      array_data(const S& s);
+
+   static size_t copy_string(char* buffer, const std::string& s);
+   static size_t copy_string(char* buffer, const char* s);
+   template <typename S>
+   static typename std::enable_if<!std::is_convertible<S, const char*>::value
+                                     && !std::is_same<S, std::string>::value,
+                                  size_t>::type
+      copy_string(char* buffer, const S& s);
+
+#ifdef STRUC_POSIX
+   //! @brief String item left out of the scratch buffer of pack_iov
+   struct gather_string
+   {
+      const char* data;
+      size_t size;
+      std::vector<iovec>* iov;
+      size_t* end;
+   };
+
+   template <typename T>
+   struct is_gathered
+   : std::integral_constant<bool,
+                            std::is_same<T, std::string>::value
+                               || std::is_same<T, const char*>::value
+                               || std::is_same<T, char*>::value>
+   {
+   };
+
+   template <typename T>
+   static typename std::enable_if<!is_gathered<T>::value, const T&>::type
+      gather(const T& t, std::vector<iovec>& iov, size_t& end);
+
+   template <typename T>
+   static typename std::enable_if<is_gathered<T>::value, gather_string>::type
+      gather(const T& t, std::vector<iovec>& iov, size_t& end);
+
+   static bool check_scalar(size_t num, const gather_string& s, status& st);
+
+   static bool pack_scalar(control c,
+                           std::pair<size_t, char>& cur,
+                           char* buffer,
+                           size_t& offset,
+                           status& st,
+                           const gather_string& s);
+#endif
+
+   template <typename T, typename A>
+   static bool pack_scalar(control c,
+                           std::pair<size_t, char>& cur,
+                           char* buffer,
+                           size_t& offset,
+                           status& st,
+                           const std::vector<T, A>& v);
+
+   template <typename T>
+   static bool pack_scalar(control c,
+                           std::pair<size_t, char>& cur,
+                           char* buffer,
+                           size_t& offset,
+                           status& st,
+                           const span<T>& s);
+
+   template <typename E>
+   static bool pack_array(control c,
+                          std::pair<size_t, char>& cur,
+                          char* buffer,
+                          size_t& offset,
+                          status& st,
+                          const E* e,
+                          size_t n);
+
    template <typename F>
-   static typename std::enable_if<std::is_same<F, float>::value, void>::type
+   static typename std::enable_if<std::is_same<F, float>::value, bool>::type
       unpack_non_ieee(bool litte_endian,
                       const char* buffer,
                       size_t& offset,
+                      status& st,
                       F& f);
 
    template <typename F>
-   static typename std::enable_if<std::is_same<F, double>::value, void>::type
+   static typename std::enable_if<std::is_same<F, double>::value, bool>::type
       unpack_non_ieee(bool litte_endian,
                       const char* buffer,
                       size_t& offset,
+                      status& st,
                       F& f);
 
    template <typename F>
    static typename std::enable_if<!std::is_same<F, float>::value
                                      && !std::is_same<F, double>::value,
-                                  void>::type
+                                  bool>::type
       unpack_non_ieee(bool litte_endian,
                       const char* buffer,
                       size_t& offset,
+                      status& st,
                       F& f);
 
    template <typename I, typename T, typename U = T>
@@ -252,54 +938,62 @@ private:
       unpack_native(const char* buffer, size_t& offset, I& i);
 
    template <typename F, typename T, typename U = T>
-   static typename std::enable_if<std::is_floating_point<T>::value, void>::type
-      unpack_native(const char* buffer, size_t& offset, F& f);
+   static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+      unpack_native(const char* buffer, size_t& offset, status& st, F& f);
 
    template <typename I, typename T, typename U = T>
    static typename std::enable_if<std::is_integral<T>::value, void>::type
       unpack_non_native(control c, const char* buffer, size_t& offset, I& i);
 
    template <typename F, typename T, typename U = T>
-   static typename std::enable_if<std::is_floating_point<T>::value, void>::type
-      unpack_non_native(control c, const char* buffer, size_t& offset, F& f);
+   static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+      unpack_non_native(control c,
+                        const char* buffer,
+                        size_t& offset,
+                        status& st,
+                        F& f);
 
    template <typename I>
-   static typename std::enable_if<std::is_arithmetic<I>::value, void>::type
+   static typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
       unpack_scalar(control c,
                     std::pair<size_t, char>& cur,
                     const char* buffer,
                     size_t& offset,
+                    status& st,
                     I& i);
 
    template <typename A>
    static typename std::enable_if<std::is_array<A>::value
                                      && !std::is_constructible<std::string,
                                                                A>::value,
-                                  void>::type
+                                  bool>::type
       unpack_scalar(control c,
                     std::pair<size_t, char>& cur,
                     const char* buffer,
                     size_t& offset,
+                    status& st,
                     A& a);
 
    template <typename S>
    static
-      typename std::enable_if<std::is_same<std::string, S>::value, void>::type
+      typename std::enable_if<std::is_same<std::string, S>::value, bool>::type
       unpack_scalar(control c,
                     std::pair<size_t, char>& cur,
                     const char* buffer,
                     size_t& offset,
+                    status& st,
                     S& s);
 
    template <typename S>
    static typename std::enable_if<std::is_constructible<std::string, S>::value
                                      && !std::is_null_pointer<S>::value
                                      && !std::is_same<std::string, S>::value,
-                                  void>::type
+                                  bool>::type
       unpack_scalar(control c,
                     std::pair<size_t, char>& cur,
                     const char* buffer,
                     size_t& offset,
+                    status& st,
                     S& s);
 
    template <typename P>
@@ -307,1674 +1001,6893 @@ private:
       typename std::enable_if<(std::is_pointer<P>::value
                                && !std::is_constructible<std::string, P>::value)
                                  || std::is_member_pointer<P>::value,
-                              void>::type
+                              bool>::type
       unpack_scalar(control c,
                     std::pair<size_t, char>& cur,
                     const char* buffer,
                     size_t& offset,
+                    status& st,
                     P& p);
 
+   template <typename T, size_t N>
+   static bool unpack_scalar(control c,
+                             std::pair<size_t, char>& cur,
+                             const char* buffer,
+                             size_t& offset,
+                             status& st,
+                             std::array<T, N>& a);
+
+   template <typename T, typename A>
+   static bool unpack_scalar(control c,
+                             std::pair<size_t, char>& cur,
+                             const char* buffer,
+                             size_t& offset,
+                             status& st,
+                             std::vector<T, A>& v);
+
+   template <typename T>
+   static bool unpack_scalar(control c,
+                             std::pair<size_t, char>& cur,
+                             const char* buffer,
+                             size_t& offset,
+                             status& st,
+                             const span<T>& s);
+
+   template <typename E>
+   static bool unpack_array(control c,
+                            std::pair<size_t, char>& cur,
+                            const char* buffer,
+                            size_t& offset,
+                            status& st,
+                            E* e,
+                            size_t n);
+
+   //! @brief A compiled run of items of the same type
+   struct field
+   {
+      char type;
+      size_t count;
+      size_t offset;
+      size_t size;
+      size_t item;
+   };
+
    template <typename T>
-   size_t pack_helper(std::pair<size_t, size_t>& pos,
+   size_t pack_helper(size_t& index,
                       std::pair<size_t, char>& cur,
-                      char*& buffer,
+                      char* buffer,
                       size_t& offset,
+                      status& st,
                       const T& t) const;
 
    template <typename T, typename... Ts>
-   size_t pack_helper(std::pair<size_t, size_t>& pos,
+   size_t pack_helper(size_t& index,
                       std::pair<size_t, char>& cur,
-                      char*& buffer,
+                      char* buffer,
                       size_t& offset,
+                      status& st,
                       const T& t,
                       const Ts&... ts) const;
 
    template <size_t I = 0, typename... T>
    typename std::enable_if<I == sizeof...(T), size_t>::type pack_helper_t(
-      std::pair<size_t, size_t>& pos,
+      size_t& index,
       std::pair<size_t, char>& cur,
-      char*& buffer,
+      char* buffer,
       size_t& offset,
+      status& st,
       const std::tuple<T...>& t) const;
 
    template <size_t I = 0, typename... T>
       typename std::enable_if < I<sizeof...(T), size_t>::type pack_helper_t(
-                                   std::pair<size_t, size_t>& pos,
+                                   size_t& index,
                                    std::pair<size_t, char>& cur,
-                                   char*& buffer,
+                                   char* buffer,
                                    size_t& offset,
+                                   status& st,
                                    const std::tuple<T...>& t) const;
 
    template <typename T>
-   size_t unpack_helper(std::pair<size_t, size_t>& pos,
+   size_t unpack_helper(size_t& index,
                         std::pair<size_t, char>& cur,
-                        const char*& buffer,
+                        const char* buffer,
                         size_t& offset,
+                        status& st,
                         T& t) const;
 
    template <typename T, typename... Ts>
-   size_t unpack_helper(std::pair<size_t, size_t>& pos,
+   size_t unpack_helper(size_t& index,
                         std::pair<size_t, char>& cur,
-                        const char*& buffer,
+                        const char* buffer,
                         size_t& offset,
+                        status& st,
                         T& t,
                         Ts&... ts) const;
 
    template <size_t I = 0, typename... T>
    typename std::enable_if<I == sizeof...(T), size_t>::type unpack_helper_t(
-      std::pair<size_t, size_t>& pos,
+      size_t& index,
       std::pair<size_t, char>& cur,
-      const char*& buffer,
+      const char* buffer,
       size_t& offset,
+      status& st,
       std::tuple<T...>& t) const;
 
    template <size_t I = 0, typename... T>
       typename std::enable_if < I<sizeof...(T), size_t>::type unpack_helper_t(
-                                   std::pair<size_t, size_t>& pos,
+                                   size_t& index,
                                    std::pair<size_t, char>& cur,
-                                   const char*& buffer,
+                                   const char* buffer,
                                    size_t& offset,
+                                   status& st,
                                    std::tuple<T...>& t) const;
 
-   size_t calcsize_helper(std::pair<size_t, size_t>& pos,
-                          size_t& no_of_items) const;
+   size_t missing_items(size_t index,
+                        const std::pair<size_t, char>& cur) const;
 
-   std::string pattern;
-   control c;
-};
+   bool check_items(size_t items,
+                    size_t no_of_args,
+                    size_t index,
+                    const std::pair<size_t, char>& cur,
+                    status& st) const;
 
-template <typename I>
-inline typename std::enable_if<std::is_integral<I>::value, void>::type
-   struc::to_endian(control c, I& i)
-{
-   if (c == litte_endian)
-   {
-      boost::endian::native_to_little_inplace(i);
-   }
-   else
-   {
-      boost::endian::native_to_big_inplace(i);
-   }
-}
+   bool check_length(size_t length, size_t offset, status& st) const;
 
-template <typename F>
-inline typename std::enable_if<std::is_floating_point<F>::value, void>::type
-   struc::to_endian(control, F&)
-{
-   throw std::runtime_error(
-      "Internal error: Floating point endian conversion not allowed");
-}
+   bool check_columns(size_t columns, status& st) const;
 
-template <typename I>
-inline typename std::enable_if<std::is_integral<I>::value, void>::type
-   struc::from_endian(control c, I& i)
-{
-   if (c == litte_endian)
-   {
-      boost::endian::little_to_native_inplace(i);
-   }
-   else
-   {
-      boost::endian::big_to_native_inplace(i);
-   }
-}
+   template <typename T>
+   static T* column_data(T* t, size_t n);
 
-template <typename F>
-inline typename std::enable_if<std::is_floating_point<F>::value, void>::type
-   struc::from_endian(control, F&)
-{
-   throw std::runtime_error(
-      "Internal error: Floating point endian conversion not allowed");
-}
+   template <typename T>
+   static T* column_data(std::vector<T>& v, size_t n);
 
-template <typename S>
-inline typename std::enable_if<std::is_same<std::string, S>::value, void>::type
-   struc::check_scalar(size_t num, const S& s)
-{
-   if (s.size() != num)
+   template <typename T>
+   static const T* column_data(const std::vector<T>& v, size_t n);
+
+   template <typename T>
+   static size_t column_length(const T* t);
+
+   template <typename T>
+   static size_t column_length(const std::vector<T>& v);
+
+   bool pack_columns_helper(size_t index,
+                            char* buffer,
+                            size_t n,
+                            status& st) const;
+
+   template <typename T, typename... Ts>
+   bool pack_columns_helper(size_t index,
+                            char* buffer,
+                            size_t n,
+                            status& st,
+                            const T& column,
+                            const Ts&... columns) const;
+
+   template <typename I>
+   typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
+      pack_column(const field& f,
+                  char* buffer,
+                  size_t n,
+                  status& st,
+                  const I* i) const;
+
+   template <typename T>
+   typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type
+      pack_column(const field& f,
+                  char* buffer,
+                  size_t n,
+                  status& st,
+                  const T* t) const;
+
+   template <typename T>
+   bool pack_each(const field& f,
+                  char* buffer,
+                  size_t n,
+                  status& st,
+                  const T* t) const;
+
+   template <typename I, typename T>
+   void pack_native_column(char* buffer, size_t n, const I* i) const;
+
+   template <typename I, typename T, typename U = T>
+   void pack_non_native_column(char* buffer, size_t n, const I* i) const;
+
+   template <typename E, typename F>
+   status parallel_for(E& executor, size_t n, F f) const;
+
+   template <typename I>
+   bool sort_helper(const char* buffer,
+                    size_t n,
+                    size_t index,
+                    status& st,
+                    std::vector<I>& order) const;
+
+   template <typename U, typename I>
+   void radix_sort(const char* buffer,
+                   size_t n,
+                   U flip,
+                   bool floating,
+                   std::vector<I>& order) const;
+
+   template <typename I>
+   void permute_records(char* buffer, std::vector<I>& order) const;
+
+   static const size_t scan_block = 1024;
+
+   template <size_t I = 0, typename... T>
+   typename std::enable_if<I == sizeof...(T), bool>::type scan_helper(
+      const char* buffer,
+      size_t n,
+      unsigned char* mask,
+      status& st,
+      const std::tuple<const condition<T>&...>& conditions,
+      std::tuple<std::unique_ptr<T[]>...>& scratch) const;
+
+   template <size_t I = 0, typename... T>
+   typename std::enable_if<(I < sizeof...(T)), bool>::type scan_helper(
+      const char* buffer,
+      size_t n,
+      unsigned char* mask,
+      status& st,
+      const std::tuple<const condition<T>&...>& conditions,
+      std::tuple<std::unique_ptr<T[]>...>& scratch) const;
+
+   template <typename T, typename F>
+   bool for_each_block(const char* buffer,
+                       size_t n,
+                       size_t index,
+                       status& st,
+                       F f) const;
+
+   template <typename T>
+   static void merge(summary<T>& s, const summary<T>& t);
+
+   template <typename T>
+   static summary<T> empty_summary();
+
+   template <typename T>
+   bool summarize_helper(const char* buffer,
+                         size_t n,
+                         size_t index,
+                         status& st,
+                         summary<T>& s) const;
+
+   template <typename T>
+   bool histogram_helper(const char* buffer,
+                         size_t n,
+                         size_t index,
+                         double low,
+                         double high,
+                         status& st,
+                         std::vector<size_t>& h) const;
+
+   static void check_histogram(double low, double high, size_t buckets);
+
+   template <typename T>
+   static void compare_block(compare op,
+                             const T* t,
+                             size_t n,
+                             const T& value,
+                             unsigned char* mask);
+
+   template <typename E, typename... T>
+   void unpack_column_chunks(E& executor,
+                             const char* buffer,
+                             size_t n,
+                             T*... columns) const;
+
+   template <typename E, typename... T>
+   void pack_column_chunks(E& executor,
+                           char* buffer,
+                           size_t n,
+                           const T*... columns) const;
+
+   bool check_column_lengths(size_t index, size_t n, status& st) const;
+
+   template <typename T, typename... Ts>
+   bool check_column_lengths(size_t index,
+                             size_t n,
+                             status& st,
+                             const T& column,
+                             const Ts&... columns) const;
+
+   bool unpack_columns_helper(size_t index,
+                              const char* buffer,
+                              size_t n,
+                              status& st) const;
+
+   template <typename T, typename... Ts>
+   bool unpack_columns_helper(size_t index,
+                              const char* buffer,
+                              size_t n,
+                              status& st,
+                              T&& column,
+                              Ts&&... columns) const;
+
+   template <typename I>
+   typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
+      unpack_column(const field& f,
+                    const char* buffer,
+                    size_t n,
+                    status& st,
+                    I* i) const;
+
+   template <typename T>
+   typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type
+      unpack_column(const field& f,
+                    const char* buffer,
+                    size_t n,
+                    status& st,
+                    T* t) const;
+
+   template <typename T>
+   bool unpack_each(const field& f,
+                    const char* buffer,
+                    size_t n,
+                    status& st,
+                    T* t) const;
+
+   template <typename I, typename T>
+   void unpack_native_column(const char* buffer, size_t n, I* i) const;
+
+   template <typename I, typename T, typename U = T>
+   void unpack_non_native_column(const char* buffer, size_t n, I* i) const;
+
+   size_t no_of_items() const;
+
+   const field* item_field(size_t index, size_t& offset) const;
+
+   template <size_t... I>
+   struct indices
+   {
+   };
+
+   template <typename A, typename B>
+   struct concat_indices;
+
+   template <size_t N, typename D = void>
+   struct make_indices;
+
+   template <char T, size_t O, size_t S>
+   struct item;
+
+   template <typename... I>
+   struct item_list
+   {
+   };
+
+   template <typename A, typename B>
+   struct concat_items;
+
+   template <char T, size_t O, size_t S, typename I>
+   struct run;
+
+   template <typename N, typename E>
+   struct integer_code;
+
+   template <typename F, typename U>
+   struct float_code;
+
+   template <typename B>
+   struct byte_code;
+
+   struct string_code;
+
+   struct pointer_code;
+
+   struct padding_code;
+
+   template <char T, typename D = void>
+   struct code;
+
+   template <char T, size_t O, size_t S, size_t N>
+   struct field_items;
+
+   template <typename C,
+             size_t Size,
+             size_t Num,
+             bool Digits,
+             typename Items,
+             char... P>
+   struct parser;
+
+   template <typename C,
+             size_t Size,
+             size_t Num,
+             bool Digits,
+             typename Items,
+             char T,
+             char... P>
+   struct field_parser;
+
+   template <char... P>
+   struct pattern_parser;
+
+   //! @brief Passes elements unchanged to pack_many_vector
+   struct identity
+   {
+      template <typename T>
+      const T& operator()(const T& t) const;
+   };
+
+   template <typename It, typename F>
+   std::vector<char> pack_many_vector(It first,
+                                      It last,
+                                      F f,
+                                      std::forward_iterator_tag) const;
+   template <typename It, typename F>
+   std::vector<char> pack_many_vector(It first,
+                                      It last,
+                                      F f,
+                                      std::input_iterator_tag) const;
+
+   static size_t record_count(const char* what,
+                              size_t length,
+                              size_t size,
+                              size_t stride);
+
+   //! @brief Throw unless records of size bytes can be streamed
+   static void check_record_size(const char* what, size_t size);
+
+#ifdef STRUC_POSIX
+   //! @brief Write all of iov, returns errno or 0, written is the number
+   //! of bytes written either way
+   static int write_iov(int fd, iovec* iov, int count, size_t& written);
+#endif
+
+   static constexpr size_t max_of(size_t a);
+
+   template <typename... A>
+   static constexpr size_t max_of(size_t a, size_t b, A... c);
+
+   control c;
+   std::vector<field> fields;
+   size_t size;
+   size_t record_stride;
+};
+
+//! @brief Allows comparing std::error_code with struc::errc
+inline std::error_code make_error_code(struc::errc e);
+
+namespace std
+{
+template <>
+struct is_error_code_enum<struc::errc> : true_type
+{
+};
+}
+
+//! @brief Process wide cache of compiled patterns
+//!
+//! Lookups first go to a small per-thread table, so repeated lookups of the
+//! same pattern take no lock. Misses go to a shared table bounded by
+//! capacity(), which evicts the least recently used pattern. Compiled
+//! patterns are immutable and may be kept after they have been evicted.
+//! Changing the capacity or clearing the cache also invalidates the
+//! per-thread tables, and with a capacity of 0 nothing is cached at all.
+class struc::cache
+{
+public:
+   //! @brief Compiled pattern, from the cache if possible
+   static std::shared_ptr<const struc> get(const std::string& pattern);
+
+   //! @brief Maximum number of patterns in the shared table
+   //! @{
+   static size_t capacity();
+   static void capacity(size_t capacity);
+   //! @}
+
+   //! @brief Number of patterns in the shared table
+   static size_t size();
+
+   //! @brief Remove all patterns from the shared table
+   static void clear();
+
+private:
+   friend class struc;
+
+   typedef std::pair<std::string, std::shared_ptr<const struc>> entry;
+
+   struct table
+   {
+      std::mutex mutex;
+      std::list<entry> entries;
+      std::unordered_map<std::string, std::list<entry>::iterator> index;
+      size_t capacity;
+      // bumped by clear() and capacity(size_t) to invalidate local slots
+      std::atomic<size_t> generation;
+   };
+
+   struct local_entry
+   {
+      entry e;
+      size_t generation;
+   };
+
+   static const size_t local_slots = 16;
+
+   static table& shared();
+
+   static std::shared_ptr<const struc> lookup(const std::string& pattern);
+
+   static std::shared_ptr<const struc> lookup_shared(
+      const std::string& pattern,
+      bool& cached);
+
+   static void evict(table& t);
+};
+
+//! @brief Read only access to single items of a packed buffer
+//!
+//! Items are decoded one at a time at their compiled offsets, so reading a
+//! few items of a large record does not pay for unpacking the rest. Items
+//! are numbered like the arguments to unpack, with arrays counting as one
+//! item per element. The struc must outlive the view.
+class struc::view
+{
+public:
+   //! @brief Constructor
+   view(const struc& s, const char* buffer);
+
+   //! @brief Decode item index
+   //! @{
+   template <typename T>
+   T get(size_t index) const;
+   template <typename T>
+   void get(size_t index, T& t) const;
+   //! @}
+
+   //! @brief Unpack the whole record
+   //! @{
+   template <typename... T>
+   void unpack(T&... t) const;
+   template <typename... T>
+   void unpack(std::tuple<T...>& t) const;
+   //! @}
+
+   //! @brief Packed bytes of item index
+   const char* data(size_t index) const;
+
+   //! @brief The packed buffer
+   const char* data() const;
+
+private:
+   template <typename V>
+   friend class records;
+
+   const struc* s;
+   const char* buffer;
+};
+
+//! @brief Range of back-to-back records
+//!
+//! Dereferencing an iterator gives a view of one record. Iterators move by
+//! a fixed stride, so walking the range does no pattern handling at all.
+template <typename V>
+class struc::records
+{
+public:
+   class iterator;
+
+   //! @brief Constructor, first is a view of the first record
+   records(const V& first, size_t stride, size_t count);
+
+   //! @brief Iterators over the records
+   //! @{
+   iterator begin() const;
+   iterator end() const;
+   //! @}
+
+   //! @brief Number of records
+   size_t size() const;
+
+   //! @brief Whether there are no records
+   bool empty() const;
+
+   //! @brief View of record n
+   V operator[](size_t n) const;
+
+private:
+   V first;
+   size_t stride;
+   size_t count;
+};
+
+//! @brief Random access iterator over records
+//!
+//! Dereferencing returns the view by value and operator-> a proxy holding a
+//! copy, so neither refers into the iterator, e.g. inside
+//! std::reverse_iterator.
+template <typename V>
+class struc::records<V>::iterator
+{
+public:
+   //! @brief Result of operator->
+   class arrow
+   {
+   public:
+      //! @brief Constructor
+      explicit arrow(const V& v);
+
+      const V* operator->() const;
+
+   private:
+      V v;
+   };
+
+   typedef std::random_access_iterator_tag iterator_category;
+   typedef V value_type;
+   typedef std::ptrdiff_t difference_type;
+   typedef arrow pointer;
+   typedef V reference;
+
+   //! @brief Constructor
+   iterator(const V& v, size_t stride);
+
+   reference operator*() const;
+   pointer operator->() const;
+   V operator[](difference_type n) const;
+
+   iterator& operator++();
+   iterator operator++(int);
+   iterator& operator--();
+   iterator operator--(int);
+   iterator& operator+=(difference_type n);
+   iterator& operator-=(difference_type n);
+   iterator operator+(difference_type n) const;
+   iterator operator-(difference_type n) const;
+   difference_type operator-(const iterator& other) const;
+
+   bool operator==(const iterator& other) const;
+   bool operator!=(const iterator& other) const;
+   bool operator<(const iterator& other) const;
+   bool operator>(const iterator& other) const;
+   bool operator<=(const iterator& other) const;
+   bool operator>=(const iterator& other) const;
+
+private:
+   V v;
+   std::ptrdiff_t stride;
+};
+
+//! @brief Runs the chunks of the parallel batch functions on threads
+//!
+//! Each call starts up to concurrency() - 1 new threads and joins them
+//! before returning, and the calling thread takes its share of the chunks
+//! too. No threads are kept between calls, so the cost of starting them,
+//! tens of microseconds each, is paid by every call; batches should be
+//! large enough to hide it, or use an executor backed by a thread pool.
+class struc::thread_executor
+{
+public:
+   //! @brief Constructor, 0 threads means the hardware concurrency
+   explicit thread_executor(size_t threads = 0);
+
+   //! @brief Number of threads used
+   size_t concurrency() const;
+
+   //! @brief Call task(0) to task(chunks - 1) and wait for them to finish
+   //!
+   //! If a task throws, the remaining chunks are skipped and the first
+   //! exception is rethrown on the calling thread once all threads joined.
+   void operator()(size_t chunks,
+                   const std::function<void(size_t)>& task) const;
+
+private:
+   size_t threads;
+};
+
+//! @brief Pointer and length of contiguous elements
+template <typename T>
+class struc::span
+{
+public:
+   //! @brief Constructor
+   span(T* data, size_t size);
+
+   //! @brief The elements
+   T* data() const;
+
+   //! @brief Number of elements
+   size_t size() const;
+
+private:
+   T* ptr;
+   size_t length;
+};
+
+#ifdef STRUC_POSIX
+//! @brief Read only memory mapping of a file of records
+//!
+//! Opening maps the whole file without reading it, records are paged in as
+//! they are accessed. Record i is a view at header_size() + i * stride(), so
+//! random access is as cheap as sequential. The struc must outlive the
+//! mapping, and views must not outlive it.
+class struc::mapped_file
+{
+public:
+   //! @brief Access pattern hints, see madvise
+   enum class advice
+   {
+      normal,
+      sequential,
+      random,
+      willneed,
+      dontneed
+   };
+
+   //! @brief Constructor, maps the records of path after a header of
+   //! header_size bytes
+   //!
+   //! Throws std::system_error if the file cannot be mapped, and
+   //! std::out_of_range if it is shorter than the header or ends with a
+   //! partial record.
+   mapped_file(const struc& s,
+               const std::string& path,
+               size_t header_size = 0);
+
+   //! @brief Number of records
+   size_t size() const;
+
+   //! @brief Whether there are no records
+   bool empty() const;
+
+   //! @brief View of record i
+   //! @{
+   view operator[](size_t i) const;
+   view at(size_t i) const;
+   //! @}
+
+   //! @brief Iterators over the records
+   //! @{
+   records<view>::iterator begin() const;
+   records<view>::iterator end() const;
+   //! @}
+
+   //! @brief Hint how records will be accessed, all of them or count
+   //! records from first
+   //! @{
+   void advise(advice a) const;
+   void advise(advice a, size_t first, size_t count) const;
+   //! @}
+
+   //! @brief The header
+   const char* header() const;
+
+   //! @brief Size of the header
+   size_t header_size() const;
+
+   //! @brief The first record
+   const char* data() const;
+
+private:
+   struct unmapper
+   {
+      size_t length;
+      void operator()(char* p) const;
+   };
+
+   static int native_advice(advice a);
+
+   const struc* s;
+   std::unique_ptr<char, unmapper> mapping;
+   size_t skip;
+   size_t count;
+};
+#endif
+
+//! @brief Decodes a stream of back-to-back records read in large chunks
+//!
+//! Records are stride() bytes apart, like for iter_unpack, and the last one
+//! may lack its trailing padding. Each read fills as much of the chunk as
+//! the source gives, and every complete record in it is handed out as a
+//! view into the chunk. Only a partial record at the end of a chunk is
+//! copied, to the front of the chunk for the next read. A view is valid
+//! until the next record is read. The struc must outlive the reader.
+class struc::reader
+{
+public:
+   class iterator;
+
+   //! @brief Constructor, reads chunks of chunk_size bytes from a file
+   //! descriptor or an input stream
+   //! @{
+#ifdef STRUC_POSIX
+   reader(const struc& s, int fd, size_t chunk_size = 1 << 20);
+#endif
+   reader(const struc& s, std::istream& is, size_t chunk_size = 1 << 20);
+   //! @}
+
+   //! @brief Read the next record, false at the end of the stream
+   //!
+   //! Throws std::out_of_range if the stream ends with a partial record,
+   //! and std::system_error if reading fails.
+   bool next(view& v);
+
+   //! @brief Call f(view) for all remaining records, returns their number
+   template <typename F>
+   size_t for_each(F f);
+
+   //! @brief Input iterators over the remaining records
+   //! @{
+   iterator begin();
+   iterator end();
+   //! @}
+
+private:
+   bool fill();
+
+   const struc* s;
+   int fd;
+   std::istream* is;
+   std::vector<char> chunk;
+   size_t pos;
+   size_t filled;
+   bool eof;
+   view current;
+};
+
+//! @brief Input iterator over the records of a reader
+class struc::reader::iterator
+{
+public:
+   typedef std::input_iterator_tag iterator_category;
+   typedef view value_type;
+   typedef std::ptrdiff_t difference_type;
+   typedef const view* pointer;
+   typedef const view& reference;
+
+   //! @brief Constructor, nullptr for the end iterator
+   explicit iterator(reader* r);
+
+   reference operator*() const;
+   pointer operator->() const;
+
+   iterator& operator++();
+
+   bool operator==(const iterator& other) const;
+   bool operator!=(const iterator& other) const;
+
+private:
+   reader* r;
+};
+
+//! @brief Decodes records from fragments of a stream as they arrive
+//!
+//! Records are stride() bytes apart. Each record complete in a fragment is
+//! passed to the callback as a view into the fragment, without a copy. Only
+//! a record split across fragments is gathered, into a buffer of one
+//! record, and passed on once its last byte arrives. A record is complete
+//! after calcsize() bytes, its trailing padding is skipped as it arrives,
+//! so the last record of a stream need not be padded. A view is valid only
+//! during the callback. The struc must outlive the decoder.
+class struc::decoder
+{
+public:
+   //! @brief Constructor, on_record is called with a view of each record
+   decoder(const struc& s, std::function<void(const view&)> on_record);
+
+   //! @brief Decode the records completed by a fragment, returns their
+   //! number
+   //!
+   //! If on_record throws, the rest of the fragment is lost and the decoder
+   //! is out of step with the stream. It must be reset() before it is fed
+   //! again, from the start of a record.
+   size_t feed(const char* data, size_t length);
+
+   //! @brief Number of bytes held of a record not yet passed on
+   size_t pending() const;
+
+   //! @brief Drop a partial record
+   void reset();
+
+private:
+   const struc* s;
+   std::function<void(const view&)> on_record;
+   std::vector<char> partial;
+   // bytes of the current record received, including skipped padding
+   size_t held;
+};
+
+//! @brief Splits a stream into frames of a header and a payload
+//!
+//! Each frame is a header packed with a struc, one item of which is the
+//! length of the payload that follows it. The stream is received straight
+//! into the buffer of the framer, see prepare() and commit(), and drain()
+//! passes each complete frame to the callback as a view of its header and
+//! a pointer into the buffer to its payload, without copying either. Only
+//! bytes left after a drain are moved to the front of the buffer. The
+//! buffer has a fixed capacity, so when frames are not drained, prepare()
+//! returns no space and the stream should not be read. Views and payloads
+//! are valid only during the callback. The struc must outlive the framer.
+class struc::framer
+{
+public:
+   typedef std::function<void(const view& header,
+                              const char* payload,
+                              size_t length)>
+      callback;
+
+   //! @brief Constructor
+   //!
+   //! Item length_index of header is the length of the payload, or of the
+   //! whole frame if includes_header, and must be an integer. Frames with a
+   //! payload larger than max_payload are rejected. The buffer holds
+   //! capacity bytes, at least enough for one frame of the largest size,
+   //! and 0 means two. Throws std::length_error if such a frame would not
+   //! fit in memory.
+   framer(const struc& header,
+          size_t length_index,
+          callback on_frame,
+          size_t max_payload = 1 << 16,
+          bool includes_header = false,
+          size_t capacity = 0);
+
+   //! @brief Space to receive at most space bytes into
+   char* prepare(size_t& space);
+
+   //! @brief Account for length bytes received into the space of prepare()
+   void commit(size_t length);
+
+   //! @brief Pass up to max_frames complete frames to the callback, returns
+   //! their number
+   //!
+   //! Throws std::length_error if a header gives a length out of range.
+   //! The bad header is kept, so later calls throw too, and the stream must
+   //! be dropped.
+   size_t drain(size_t max_frames = std::numeric_limits<size_t>::max());
+
+   //! @brief Number of bytes received but not yet drained
+   size_t pending() const;
+
+private:
+   const struc* s;
+   size_t length_index;
+   callback on_frame;
+   size_t max_payload;
+   bool includes_header;
+   std::vector<char> buffer;
+   size_t pos;
+   size_t filled;
+};
+
+#ifdef STRUC_POSIX
+//! @brief Packs records into a large buffer written out in one go
+//!
+//! Records are packed stride() bytes apart, as reader and mapped_file expect
+//! them, into a buffer that is reused for the life of the writer. The buffer
+//! is written when it is full, on flush() and on destruction, so there is
+//! neither an allocation nor a system call per record. The struc must
+//! outlive the writer, the file descriptor is not closed.
+class struc::writer
+{
+public:
+   //! @brief When the file is synced to disk
+   enum class sync_policy
+   {
+      none,
+      every_flush
+   };
+
+   //! @brief Constructor
+   writer(const struc& s,
+          int fd,
+          size_t buffer_size = 1 << 20,
+          sync_policy policy = sync_policy::none);
+
+   //! @brief Destructor, writes what is buffered, errors are ignored
+   ~writer();
+
+   writer(const writer&) = delete;
+   writer& operator=(const writer&) = delete;
+
+   //! @brief Pack a record
+   //! @{
+   template <typename... T>
+   void write(const T&... t);
+   template <typename... T>
+   void write(const std::tuple<T...>& t);
+   //! @}
+
+   //! @brief Append raw bytes, such as a file header
+   //!
+   //! Bytes that do not fit in the buffer are written together with it by a
+   //! single writev, without being copied.
+   void write_bytes(const char* data, size_t length);
+
+   //! @brief Write what is buffered, and sync if the policy says so
+   //!
+   //! Throws std::system_error if writing fails.
+   void flush();
+
+   //! @brief Write what is buffered and sync the file to disk
+   void sync();
+
+   //! @brief Number of bytes buffered
+   size_t buffered() const;
+
+private:
+   void reserve();
+   void commit();
+   int write_all(const char* data, size_t length);
+
+   const struc* s;
+   int fd;
+   sync_policy policy;
+   std::vector<char> buffer;
+   size_t pos;
+};
+
+//! @brief Packs records into buffers written by a background thread
+//!
+//! Like writer, but a full buffer is handed to an I/O thread and packing
+//! goes on in an empty one, so the producer only waits for the disk when
+//! all buffers are waiting to be written. Such waits are counted by
+//! stalls(). The struc must outlive the writer, the file descriptor is not
+//! closed. Only one thread may pack records at a time.
+class struc::async_writer
+{
+public:
+   //! @brief Constructor, buffers is at least 2
+   async_writer(const struc& s,
+                int fd,
+                size_t buffer_size = 1 << 20,
+                size_t buffers = 2);
+
+   //! @brief Destructor, writes what is buffered, errors are ignored
+   ~async_writer();
+
+   async_writer(const async_writer&) = delete;
+   async_writer& operator=(const async_writer&) = delete;
+
+   //! @brief Pack a record
+   //!
+   //! Throws std::system_error if the I/O thread failed to write.
+   //! @{
+   template <typename... T>
+   void write(const T&... t);
+   template <typename... T>
+   void write(const std::tuple<T...>& t);
+   //! @}
+
+   //! @brief Write what is buffered and wait for it to be written
+   void flush();
+
+   //! @brief flush() and sync the file to disk
+   void sync();
+
+   //! @brief Number of full buffers waiting to be, or being, written
+   size_t queue_depth() const;
+
+   //! @brief Number of times packing waited for an empty buffer
+   size_t stalls() const;
+
+private:
+   void reserve();
+   void commit();
+   void hand_off(std::unique_lock<std::mutex>& lock);
+   void run();
+
+   const struc* s;
+   int fd;
+   std::vector<char> active;
+   size_t pos;
+   std::mutex mutex;
+   std::condition_variable ready;
+   std::condition_variable drained;
+   std::deque<std::pair<std::vector<char>, size_t>> full;
+   std::vector<std::vector<char>> empty;
+   std::atomic<size_t> depth;
+   std::atomic<size_t> stall_count;
+   int error;
+   bool writing;
+   bool stopping;
+   std::thread thread;
+};
+#endif
+
+template <typename I>
+inline typename std::enable_if<std::is_integral<I>::value, void>::type
+   struc::to_endian(control c, I& i)
+{
+   if (c == litte_endian)
+   {
+      boost::endian::native_to_little_inplace(i);
+   }
+   else
+   {
+      boost::endian::native_to_big_inplace(i);
+   }
+}
+
+template <typename F>
+inline typename std::enable_if<std::is_floating_point<F>::value, void>::type
+   struc::to_endian(control, F&)
+{
+   STRUC_THROW(std::runtime_error(
+      "Internal error: Floating point endian conversion not allowed"));
+}
+
+template <typename I>
+inline typename std::enable_if<std::is_integral<I>::value, void>::type
+   struc::from_endian(control c, I& i)
+{
+   if (c == litte_endian)
+   {
+      boost::endian::little_to_native_inplace(i);
+   }
+   else
+   {
+      boost::endian::big_to_native_inplace(i);
+   }
+}
+
+template <typename F>
+inline typename std::enable_if<std::is_floating_point<F>::value, void>::type
+   struc::from_endian(control, F&)
+{
+   STRUC_THROW(std::runtime_error(
+      "Internal error: Floating point endian conversion not allowed"));
+}
+
+template <typename S>
+inline typename std::enable_if<std::is_same<std::string, S>::value, bool>::type
+   struc::check_scalar(size_t num, const S& s, status& st)
+{
+   if (s.size() != num)
+   {
+      return fail(st, errc::wrong_string_length, num, s.size());
+   }
+   return true;
+}
+
+template <typename S>
+inline typename std::enable_if<std::is_constructible<std::string, S>::value
+                                  && !std::is_null_pointer<S>::value
+                                  && !std::is_same<std::string, S>::value,
+                               bool>::type
+   struc::check_scalar(size_t num, const S& s, status& st)
+{
+   auto len = string_size(s);
+   if (len != num)
+   {
+      return fail(st, errc::wrong_string_length, num, len);
+   }
+   return true;
+}
+
+template <typename S>
+inline typename std::enable_if<!std::is_constructible<std::string, S>::value
+                                  || std::is_null_pointer<S>::value,
+                               bool>::type
+   struc::check_scalar(size_t, const S&, status&)
+{
+   return true;
+}
+
+template <typename S>
+inline typename std::enable_if<std::is_same<std::string, S>::value, void>::type
+   struc::prep_scalar(size_t num, S& s)
+{
+   s = S(num, '\0');
+}
+
+template <typename S>
+inline typename std::enable_if<std::is_constructible<std::string, S>::value
+                                  && !std::is_null_pointer<S>::value
+                                  && !std::is_same<std::string, S>::value,
+                               void>::type
+   struc::prep_scalar(size_t num, S& s)
+{
+   for (size_t i = 0; i < num; ++i)
+   {
+      s[i] = ' ';
+   }
+   s[num] = '\0';
+}
+
+template <typename S>
+inline typename std::enable_if<!std::is_constructible<std::string, S>::value
+                                  || std::is_null_pointer<S>::value,
+                               void>::type
+   struc::prep_scalar(size_t, S&)
+{
+}
+
+template <typename T>
+inline size_t struc::padding(const size_t& sz)
+{
+   size_t pad = sz % alignof(T);
+   return pad == 0 ? pad : alignof(T) - pad;
+}
+
+inline size_t struc::native_padding(const size_t& sz, char type)
+{
+   switch (type)
+   {
+   case 'h':
+      return padding<short>(sz);
+   case 'H':
+      return padding<unsigned short>(sz);
+   case 'i':
+      return padding<int>(sz);
+   case 'I':
+      return padding<unsigned int>(sz);
+   case 'l':
+      return padding<long>(sz);
+   case 'L':
+      return padding<unsigned long>(sz);
+   case 'q':
+      return padding<long long>(sz);
+   case 'Q':
+      return padding<unsigned long long>(sz);
+   case 'f':
+      return padding<float>(sz);
+   case 'd':
+      return padding<double>(sz);
+   case 'P':
+      return padding<void*>(sz);
+   case 'x':
+   case 'c':
+   case 'b':
+   case 'B':
+   case '?':
+   case 's':
+   case 'p':
+      return 0;
+   default:
+      STRUC_THROW(
+         std::logic_error(std::string("Encountered illegal type: ") + type));
+   }
+}
+
+inline size_t struc::native_alignment(char type)
+{
+   switch (type)
+   {
+   case 'h':
+      return alignof(short);
+   case 'H':
+      return alignof(unsigned short);
+   case 'i':
+      return alignof(int);
+   case 'I':
+      return alignof(unsigned int);
+   case 'l':
+      return alignof(long);
+   case 'L':
+      return alignof(unsigned long);
+   case 'q':
+      return alignof(long long);
+   case 'Q':
+      return alignof(unsigned long long);
+   case 'f':
+      return alignof(float);
+   case 'd':
+      return alignof(double);
+   case 'P':
+      return alignof(void*);
+   case 'x':
+   case 'c':
+   case 'b':
+   case 'B':
+   case '?':
+   case 's':
+   case 'p':
+      return 1;
+   default:
+      STRUC_THROW(
+         std::logic_error(std::string("Encountered illegal type: ") + type));
+   }
+}
+
+template <typename F>
+inline constexpr typename std::enable_if<std::is_same<F, float>::value
+                                            || std::is_same<F, double>::value,
+                                         bool>::type
+   struc::is_ieee()
+{
+   // decided at compile time, so the non-IEEE code is only a fallback that
+   // the optimizer removes; it is also taken on mixed endian platforms and
+   // where floats do not share the byte order of integers
+   return std::numeric_limits<F>::is_iec559
+      && sizeof(F) == (std::is_same<F, float>::value ? 4 : 8)
+      && (boost::endian::order::native == boost::endian::order::little
+          || boost::endian::order::native == boost::endian::order::big)
+      && STRUC_FLOAT_INTEGER_ORDER;
+}
+
+template <typename F>
+inline typename std::enable_if<!std::is_same<F, float>::value
+                                  && !std::is_same<F, double>::value,
+                               bool>::type
+   struc::is_ieee()
+{
+   STRUC_THROW(std::runtime_error(
+      "Internal error: Only float or double allowed for ieee check"));
+}
+
+inline bool struc::needs_swap(control c)
+{
+   return c != native
+      && (c == litte_endian)
+      != (boost::endian::order::native == boost::endian::order::little);
+}
+
+inline size_t struc::run_size(control c, char type)
+{
+   switch (type)
+   {
+   case 'h':
+   case 'H':
+      return c == native ? sizeof(short) : sizeof(int16_t);
+   case 'i':
+   case 'I':
+      return c == native ? sizeof(int) : sizeof(int32_t);
+   case 'l':
+   case 'L':
+      return c == native ? sizeof(long) : sizeof(int32_t);
+   case 'q':
+   case 'Q':
+      return c == native ? sizeof(long long) : sizeof(int64_t);
+   case 'f':
+      return is_ieee<float>() ? sizeof(float) : 0;
+   case 'd':
+      return is_ieee<double>() ? sizeof(double) : 0;
+   default:
+      return 0;
+   }
+}
+
+template <typename E>
+inline bool struc::is_run(control c, char type)
+{
+   // elements that hold the packed bits as they are, so a run of them can
+   // be copied and byte swapped in bulk
+   return run_size(c, type) == sizeof(E)
+      && (sizeof(E) == 2 || sizeof(E) == 4 || sizeof(E) == 8)
+      && std::is_floating_point<E>::value == (type == 'f' || type == 'd');
+}
+
+inline void struc::swap_bytes(char* p, size_t n, size_t size)
+{
+   static const swap_function* kernels = swap_kernels();
+   kernels[size / 4](p, n);
+}
+
+inline const struc::swap_function* struc::swap_kernels()
+{
+   return swap_kernel_tables().front();
+}
+
+inline std::vector<const struc::swap_function*> struc::swap_kernel_tables()
+{
+   std::vector<const swap_function*> tables;
+#ifdef STRUC_X86_SIMD
+   static const swap_function avx2[] = {
+      &swap_avx2<uint16_t>, &swap_avx2<uint32_t>, &swap_avx2<uint64_t>};
+   static const swap_function ssse3[] = {
+      &swap_ssse3<uint16_t>, &swap_ssse3<uint32_t>, &swap_ssse3<uint64_t>};
+   static const swap_function sse2[] = {
+      &swap_sse2<uint16_t>, &swap_sse2<uint32_t>, &swap_sse2<uint64_t>};
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+   {
+      tables.push_back(avx2);
+   }
+   if (__builtin_cpu_supports("ssse3"))
+   {
+      tables.push_back(ssse3);
+   }
+   if (__builtin_cpu_supports("sse2"))
+   {
+      tables.push_back(sse2);
+   }
+#endif
+   static const swap_function scalar[] = {
+      &swap_scalar<uint16_t>, &swap_scalar<uint32_t>, &swap_scalar<uint64_t>};
+   tables.push_back(scalar);
+   return tables;
+}
+
+template <typename U>
+inline void struc::swap_scalar(char* p, size_t n)
+{
+   for (size_t i = 0; i < n; ++i, p += sizeof(U))
+   {
+      U u;
+      std::memcpy(&u, p, sizeof(u));
+      boost::endian::endian_reverse_inplace(u);
+      std::memcpy(p, &u, sizeof(u));
+   }
+}
+
+#ifdef STRUC_X86_SIMD
+template <typename U>
+STRUC_TARGET("sse2") inline void struc::swap_sse2(char* p, size_t n)
+{
+   const size_t per_vector = 16 / sizeof(U);
+   size_t i = 0;
+   for (; i + per_vector <= n; i += per_vector, p += 16)
+   {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      if (sizeof(U) >= 4)
+      {
+         v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+      }
+      if (sizeof(U) == 8)
+      {
+         v = _mm_shuffle_epi32(v, 0xb1);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+   }
+   swap_scalar<U>(p, n - i);
+}
+
+template <typename U>
+STRUC_TARGET("ssse3") inline void struc::swap_ssse3(char* p, size_t n)
+{
+   char m[16];
+   swap_mask<U>(m);
+   const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m));
+   const size_t per_vector = 16 / sizeof(U);
+   size_t i = 0;
+   for (; i + per_vector <= n; i += per_vector, p += 16)
+   {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                       _mm_shuffle_epi8(v, mask));
+   }
+   swap_scalar<U>(p, n - i);
+}
+
+template <typename U>
+STRUC_TARGET("avx2") inline void struc::swap_avx2(char* p, size_t n)
+{
+   char m[16];
+   swap_mask<U>(m);
+   const __m256i mask = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(m)));
+   const size_t per_vector = 32 / sizeof(U);
+   size_t i = 0;
+   for (; i + per_vector <= n; i += per_vector, p += 32)
+   {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(p),
+                          _mm256_shuffle_epi8(v, mask));
+   }
+   swap_scalar<U>(p, n - i);
+}
+
+template <typename U>
+inline void struc::swap_mask(char (&mask)[16])
+{
+   // the shuffle reverses the bytes within each item
+   for (size_t i = 0; i < 16; ++i)
+   {
+      mask[i] = static_cast<char>(i - i % sizeof(U) + sizeof(U) - 1
+                                  - i % sizeof(U));
+   }
+}
+#endif
+
+template <typename F>
+inline typename std::enable_if<std::is_same<F, float>::value, bool>::type
+   struc::pack_non_ieee(
+      bool litte_endian, char* buffer, size_t& offset, status& st, F f)
+{
+   uint8_t sign = f < 0 ? 1 : 0;
+   if (sign)
+   {
+      f = -f;
+   }
+   int e;
+   auto d = std::frexp(f, &e);
+   if (0.5 <= d && d < 1.0)
+   {
+      d *= 2.0;
+      e--;
+   }
+   else if (d == 0.0)
+   {
+      e = 0;
+   }
+   else
+   {
+      return fail(st, errc::frexp_out_of_range);
+   }
+   if (e >= 128)
+   {
+      return fail(st, errc::too_large_for_ieee);
+   }
+   else if (e < -126)
+   {
+      d = std::ldexp(d, 126 + e);
+      e = 0;
+   }
+   else if (!(e == 0 && d == 0.0))
+   {
+      e += 127;
+      d -= 1.0;
+   }
+   d *= 8388608.0;
+   uint32_t bits = static_cast<uint32_t>(d + 0.5);
+   if (bits >> 23 > 0)
+   {
+      bits = 0;
+      ++e;
+      if (e >= 255)
+      {
+         return fail(st, errc::too_large_for_ieee);
+      }
+   }
+   if (litte_endian)
+   {
+      buffer[offset + 3] = static_cast<char>((sign << 7) | (e >> 1));
+      buffer[offset + 2] = static_cast<char>(
+         ((static_cast<unsigned int>(e) & 0x1) << 7) | (bits >> 16));
+      buffer[offset + 1] = static_cast<char>((bits >> 8) & 0xff);
+      buffer[offset] = static_cast<char>(bits & 0xff);
+   }
+   else
+   {
+      buffer[offset] = static_cast<char>((sign << 7) | (e >> 1));
+      buffer[offset + 1] = static_cast<char>(
+         ((static_cast<unsigned int>(e) & 0x1) << 7) | (bits >> 16));
+      buffer[offset + 2] = static_cast<char>((bits >> 8) & 0xff);
+      buffer[offset + 3] = static_cast<char>(bits & 0xff);
+   }
+   offset += 4;
+   return true;
+}
+
+template <typename F>
+inline typename std::enable_if<std::is_same<F, double>::value, bool>::type
+   struc::pack_non_ieee(
+      bool litte_endian, char* buffer, size_t& offset, status& st, F f)
+{
+   uint8_t sign = f < 0 ? 1 : 0;
+   if (sign)
+   {
+      f = -f;
+   }
+   int e;
+   auto d = std::frexp(f, &e);
+   if (0.5 <= d && d < 1.0)
+   {
+      d *= 2.0;
+      e--;
+   }
+   else if (d == 0.0)
+   {
+      e = 0;
+   }
+   else
+   {
+      return fail(st, errc::frexp_out_of_range);
+   }
+   if (e >= 1024)
+   {
+      return fail(st, errc::too_large_for_ieee);
+   }
+   else if (e < -1022)
+   {
+      d = std::ldexp(d, 1022 + e);
+      e = 0;
+   }
+   else if (!(e == 0 && d == 0.0))
+   {
+      e += 1023;
+      d -= 1.0;
+   }
+   d *= 268435456.0;
+   uint32_t hi = static_cast<uint32_t>(d);
+   d -= static_cast<double>(hi);
+   d *= 16777216.0;
+   uint32_t lo = static_cast<uint32_t>(d + 0.5);
+   if (lo >> 24 > 0)
+   {
+      lo = 0;
+      ++hi;
+      if (hi >> 28 > 0)
+      {
+         hi = 0;
+         ++e;
+         if (e >= 2047)
+         {
+            return fail(st, errc::too_large_for_ieee);
+         }
+      }
+   }
+   if (litte_endian)
+   {
+      buffer[offset + 7] = static_cast<char>((sign << 7) | (e >> 4));
+      buffer[offset + 6] = static_cast<char>(
+         ((static_cast<uint32_t>(e) & 0xf) << 4) | (hi >> 24));
+      buffer[offset + 5] = static_cast<char>((hi >> 16) & 0xff);
+      buffer[offset + 4] = static_cast<char>((hi >> 8) & 0xff);
+      buffer[offset + 3] = static_cast<char>(hi & 0xff);
+      buffer[offset + 2] = static_cast<char>((lo >> 16) & 0xff);
+      buffer[offset + 1] = static_cast<char>((lo >> 8) & 0xff);
+      buffer[offset] = static_cast<char>(lo & 0xff);
+   }
+   else
+   {
+      buffer[offset] = static_cast<char>((sign << 7) | (e >> 4));
+      buffer[offset + 1] = static_cast<char>(
+         ((static_cast<uint32_t>(e) & 0xf) << 4) | (hi >> 24));
+      buffer[offset + 2] = static_cast<char>((hi >> 16) & 0xff);
+      buffer[offset + 3] = static_cast<char>((hi >> 8) & 0xff);
+      buffer[offset + 4] = static_cast<char>(hi & 0xff);
+      buffer[offset + 5] = static_cast<char>((lo >> 16) & 0xff);
+      buffer[offset + 6] = static_cast<char>((lo >> 8) & 0xff);
+      buffer[offset + 7] = static_cast<char>(lo & 0xff);
+   }
+   offset += 8;
+   return true;
+}
+
+template <typename F>
+inline typename std::enable_if<!std::is_same<F, float>::value
+                                  && !std::is_same<F, double>::value,
+                               bool>::type
+   struc::pack_non_ieee(bool, char*, size_t&, status&, F)
+{
+   STRUC_THROW(std::runtime_error(
+      "Internal error: Only float or double allowed for ieee packing"));
+}
+
+template <typename I, typename T, typename U>
+inline typename std::enable_if<std::is_integral<T>::value, void>::type
+   struc::pack_native(char* buffer, size_t& offset, const I& i)
+{
+   T i_ = static_cast<T>(i);
+   std::memcpy(buffer + offset, &i_, sizeof(i_));
+   offset += sizeof(i_);
+}
+
+template <typename F, typename T, typename U>
+inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+   struc::pack_native(char* buffer, size_t& offset, status& st, const F& f)
+{
+   T f_ = static_cast<T>(f);
+   if (is_ieee<T>())
+   {
+      std::memcpy(buffer + offset, &f_, sizeof(f_));
+      offset += sizeof(f_);
+      return true;
+   }
+   else
+   {
+#ifdef BOOST_BIG_ENDIAN
+      return pack_non_ieee<T>(false, buffer, offset, st, f_);
+#else
+      return pack_non_ieee<T>(true, buffer, offset, st, f_);
+#endif
+   }
+}
+
+template <typename I, typename T, typename U>
+inline typename std::enable_if<std::is_integral<T>::value, void>::type
+   struc::pack_non_native(control c, char* buffer, size_t& offset, const I& i)
+{
+   T i_ = static_cast<T>(i);
+   to_endian(c, i_);
+   std::memcpy(buffer + offset, &i_, sizeof(i_));
+   offset += sizeof(i_);
+}
+
+template <typename F, typename T, typename U>
+inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+   struc::pack_non_native(control c,
+                      char* buffer,
+                      size_t& offset,
+                      status& st,
+                      const F& f)
+{
+   static_assert(sizeof(T) == sizeof(U), "Types T and U must have equal size");
+   T f_ = static_cast<T>(f);
+   if (is_ieee<T>())
+   {
+      U* i = reinterpret_cast<U*>(&f_);
+      to_endian(c, *i);
+      std::memcpy(buffer + offset, &f_, sizeof(f_));
+      offset += sizeof(f_);
+      return true;
+   }
+   else
+   {
+      return pack_non_ieee<T>(c == litte_endian, buffer, offset, st, f_);
+   }
+}
+
+template <typename I>
+inline typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
+   struc::pack_scalar(control c,
+                      std::pair<size_t, char>& cur,
+                      char* buffer,
+                      size_t& offset,
+                      status& st,
+                      const I& i)
+{
+   bool ok = true;
+   switch (cur.second)
+   {
+   case 'c':
+   case 'b':
+   case 'B':
+   case '?':
+      std::memcpy(buffer + offset, &i, 1);
+      offset += 1;
+      break;
+   case 'h':
+      c == native ? pack_native<I, short>(buffer, offset, i) :
+                    pack_non_native<I, int16_t>(c, buffer, offset, i);
+      break;
+   case 'H':
+      c == native ? pack_native<I, unsigned short>(buffer, offset, i) :
+                    pack_non_native<I, uint16_t>(c, buffer, offset, i);
+      break;
+   case 'i':
+      c == native ? pack_native<I, int>(buffer, offset, i) :
+                    pack_non_native<I, int32_t>(c, buffer, offset, i);
+      break;
+   case 'I':
+      c == native ? pack_native<I, unsigned int>(buffer, offset, i) :
+                    pack_non_native<I, uint32_t>(c, buffer, offset, i);
+      break;
+   case 'l':
+      c == native ? pack_native<I, long>(buffer, offset, i) :
+                    pack_non_native<I, int32_t>(c, buffer, offset, i);
+      break;
+   case 'L':
+      c == native ? pack_native<I, unsigned long>(buffer, offset, i) :
+                    pack_non_native<I, uint32_t>(c, buffer, offset, i);
+      break;
+   case 'q':
+      c == native ? pack_native<I, long long>(buffer, offset, i) :
+                    pack_non_native<I, int64_t>(c, buffer, offset, i);
+      break;
+   case 'Q':
+      c == native ? pack_native<I, unsigned long long>(buffer, offset, i) :
+                    pack_non_native<I, uint64_t>(c, buffer, offset, i);
+      break;
+   case 'f':
+      ok = c == native ?
+         pack_native<I, float>(buffer, offset, st, i) :
+         pack_non_native<I, float, uint32_t>(c, buffer, offset, st, i);
+      break;
+   case 'd':
+      ok = c == native ?
+         pack_native<I, double>(buffer, offset, st, i) :
+         pack_non_native<I, double, uint64_t>(c, buffer, offset, st, i);
+      break;
+   default:
+      return fail(st, errc::illegal_type);
+   }
+   if (!ok)
+   {
+      return false;
+   }
+   cur.first--;
+   return true;
+}
+
+template <typename A>
+inline
+   typename std::enable_if<std::is_array<A>::value
+                              && !std::is_constructible<std::string, A>::value,
+                           bool>::type
+   struc::pack_scalar(control c,
+                      std::pair<size_t, char>& cur,
+                      char* buffer,
+                      size_t& offset,
+                      status& st,
+                      const A& a)
+{
+   return pack_array(c, cur, buffer, offset, st, &a[0], std::extent<A>::value);
+}
+
+template <typename T, size_t N>
+inline bool struc::pack_scalar(control c,
+                               std::pair<size_t, char>& cur,
+                               char* buffer,
+                               size_t& offset,
+                               status& st,
+                               const std::array<T, N>& a)
+{
+   return pack_array(c, cur, buffer, offset, st, a.data(), N);
+}
+
+template <typename T, typename A>
+inline bool struc::pack_scalar(control c,
+                               std::pair<size_t, char>& cur,
+                               char* buffer,
+                               size_t& offset,
+                               status& st,
+                               const std::vector<T, A>& v)
+{
+   return pack_array(c, cur, buffer, offset, st, v.data(), v.size());
+}
+
+template <typename T>
+inline bool struc::pack_scalar(control c,
+                               std::pair<size_t, char>& cur,
+                               char* buffer,
+                               size_t& offset,
+                               status& st,
+                               const span<T>& s)
+{
+   return pack_array(c, cur, buffer, offset, st, s.data(), s.size());
+}
+
+template <typename E>
+inline bool struc::pack_array(control c,
+                              std::pair<size_t, char>& cur,
+                              char* buffer,
+                              size_t& offset,
+                              status& st,
+                              const E* e,
+                              size_t n)
+{
+   if (n < cur.first)
+   {
+      return fail(st, errc::array_too_small, cur.first, n);
+   }
+   else if (n > cur.first)
+   {
+      return fail(st, errc::array_too_large, cur.first, n);
+   }
+   if (std::is_arithmetic<E>::value && is_run<E>(c, cur.second))
+   {
+      std::memcpy(buffer + offset, e, n * sizeof(E));
+      if (needs_swap(c))
+      {
+         swap_bytes(buffer + offset, n, sizeof(E));
+      }
+      offset += n * sizeof(E);
+      cur.first -= n;
+      return true;
+   }
+   for (size_t i = 0; i < n; ++i)
+   {
+      if (!pack_scalar(c, cur, buffer, offset, st, e[i]))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+template <typename S>
+inline typename std::enable_if<std::is_constructible<std::string, S>::value
+                                  && !std::is_null_pointer<S>::value,
+                               bool>::type
+   struc::pack_scalar(control c,
+                      std::pair<size_t, char>& cur,
+                      char* buffer,
+                      size_t& offset,
+                      status& st,
+                      const S& s)
+{
+   switch (cur.second)
+   {
+   case 's':
+   case 'p':
+   {
+      offset += copy_string(buffer + offset, s);
+      cur.first--;
+      break;
+   }
+   case 'c':
+   {
+      if (!std::is_array<S>::value)
+      {
+         return fail(st, errc::expected_char_array);
+      }
+      if (std::extent<S>::value < cur.first)
+      {
+         return fail(
+            st, errc::array_too_small, cur.first, std::extent<S>::value);
+      }
+      else if (std::extent<S>::value > cur.first)
+      {
+         return fail(
+            st, errc::array_too_large, cur.first, std::extent<S>::value);
+      }
+      for (size_t i = 0; i < std::extent<S>::value; ++i)
+      {
+         if (!pack_scalar(c, cur, buffer, offset, st, array_data(s)[i]))
+         {
+            return false;
+         }
+      }
+      break;
+   }
+   default:
+      return fail(st, errc::illegal_type);
+   }
+   return true;
+}
+
+inline const char* struc::string_data(const std::string& s)
+{
+   return s.data();
+}
+
+inline const char* struc::string_data(const char* s)
+{
+   return s;
+}
+
+inline size_t struc::string_size(const std::string& s)
+{
+   return s.size();
+}
+
+inline size_t struc::string_size(const char* s)
+{
+   return std::strlen(s);
+}
+
+template <typename S>
+inline typename std::enable_if<!std::is_convertible<S, const char*>::value
+                                  && !std::is_same<S, std::string>::value,
+                               size_t>::type
+   struc::string_size(const S& s)
+{
+   return std::string(s).size();
+}
+
+template <typename S>
+inline typename std::enable_if<
+   std::is_array<S>::value,
+   const typename std::remove_extent<S>::type*>::type
+   struc::array_data(const S& s)
+{
+   return s;
+}
+
+template <typename S>
+inline typename std::enable_if<!std::is_array<S>::value, const char*>::type
+   struc::array_data(const S&)
+{
+   // never called at run time; 'c' rejects non-arrays before the loop
+   return nullptr;
+}
+
+inline size_t struc::copy_string(char* buffer, const std::string& s)
+{
+   // copied straight from the argument, whose length has been checked
+   std::memcpy(buffer, s.data(), s.size());
+   return s.size();
+}
+
+inline size_t struc::copy_string(char* buffer, const char* s)
+{
+   size_t n = std::strlen(s);
+   std::memcpy(buffer, s, n);
+   return n;
+}
+
+template <typename S>
+inline typename std::enable_if<!std::is_convertible<S, const char*>::value
+                                  && !std::is_same<S, std::string>::value,
+                               size_t>::type
+   struc::copy_string(char* buffer, const S& s)
+{
+   // other types only convert through a std::string
+   return copy_string(buffer, std::string(s));
+}
+
+#ifdef STRUC_POSIX
+template <typename T>
+inline typename std::enable_if<!struc::is_gathered<T>::value, const T&>::type
+   struc::gather(const T& t, std::vector<iovec>&, size_t&)
+{
+   return t;
+}
+
+template <typename T>
+inline typename std::enable_if<struc::is_gathered<T>::value,
+                               struc::gather_string>::type
+   struc::gather(const T& t, std::vector<iovec>& iov, size_t& end)
+{
+   gather_string s = {string_data(t), string_size(t), &iov, &end};
+   return s;
+}
+
+inline bool struc::check_scalar(size_t num,
+                                const gather_string& s,
+                                status& st)
+{
+   if (s.size != num)
+   {
+      return fail(st, errc::wrong_string_length, num, s.size);
+   }
+   return true;
+}
+
+inline bool struc::pack_scalar(control,
+                               std::pair<size_t, char>& cur,
+                               char* buffer,
+                               size_t& offset,
+                               status& st,
+                               const gather_string& s)
+{
+   if (cur.second != 's' && cur.second != 'p')
+   {
+      return fail(st, errc::illegal_type);
+   }
+   // the packed bytes since the last string, then the string itself
+   if (offset > *s.end)
+   {
+      s.iov->push_back({buffer + *s.end, offset - *s.end});
+   }
+   s.iov->push_back({const_cast<char*>(s.data), s.size});
+   offset += s.size;
+   *s.end = offset;
+   cur.first--;
+   return true;
+}
+#endif
+
+template <typename P>
+inline
+   typename std::enable_if<(std::is_pointer<P>::value
+                            && !std::is_constructible<std::string, P>::value)
+                              || std::is_null_pointer<P>::value
+                              || std::is_member_pointer<P>::value,
+                           bool>::type
+   struc::pack_scalar(control,
+                      std::pair<size_t, char>& cur,
+                      char* buffer,
+                      size_t& offset,
+                      status& st,
+                      const P& p)
+{
+   // the constructor only accepts P with native byte order
+   if (cur.second != 'P')
+   {
+      return fail(st, errc::illegal_type);
+   }
+   void* p_ = static_cast<void*>(p);
+   std::memcpy(buffer + offset, &p_, sizeof(p_));
+   offset += sizeof(p_);
+   cur.first--;
+   return true;
+}
+
+template <typename T>
+inline size_t struc::pack_helper(size_t& index,
+                                 std::pair<size_t, char>& cur,
+                                 char* buffer,
+                                 size_t& offset,
+                                 status& st,
+                                 const T& t) const
+{
+   if (st.code != errc())
+   {
+      return 0;
+   }
+   if (cur.first == 0)
+   {
+      if (index == fields.size())
+      {
+         return 0;
+      }
+      const auto& f = fields[index++];
+      cur.first = f.count;
+      cur.second = f.type;
+      offset = f.offset;
+      if ((f.type == 's' || f.type == 'p') && !check_scalar(f.size, t, st))
+      {
+         st.index = f.item;
+         return 0;
+      }
+   }
+   if (!pack_scalar(c, cur, buffer, offset, st, t))
+   {
+      const auto& f = fields[index - 1];
+      st.index = f.item + f.count - cur.first;
+      return 0;
+   }
+   return 1;
+}
+
+template <typename T, typename... Ts>
+inline size_t struc::pack_helper(size_t& index,
+                                 std::pair<size_t, char>& cur,
+                                 char* buffer,
+                                 size_t& offset,
+                                 status& st,
+                                 const T& t,
+                                 const Ts&... ts) const
+{
+   auto sz = pack_helper(index, cur, buffer, offset, st, t);
+   sz += pack_helper(index, cur, buffer, offset, st, ts...);
+   return sz;
+}
+
+template <typename... T>
+inline void struc::pack(char* buffer, const T&... t) const
+{
+   auto st = try_pack(buffer, t...);
+   if (st.code != errc())
+   {
+      raise("pack", st);
+   }
+}
+
+#ifdef STRUC_POSIX
+template <typename... T>
+inline void struc::pack_iov(std::vector<iovec>& iov,
+                            char* scratch,
+                            const T&... t) const
+{
+   auto st = try_pack_iov(iov, scratch, t...);
+   if (st.code != errc())
+   {
+      raise("pack_iov", st);
+   }
+}
+
+template <typename... T>
+inline struc::status struc::try_pack_iov(std::vector<iovec>& iov,
+                                         char* scratch,
+                                         const T&... t) const
+{
+   iov.clear();
+   size_t end = 0;
+   auto st = try_pack(scratch, gather(t, iov, end)...);
+   if (st.code != errc())
+   {
+      iov.clear();
+   }
+   else if (end < size)
+   {
+      iov.push_back({scratch + end, size - end});
+   }
+   return st;
+}
+#endif
+
+template <typename... T>
+inline struc::status struc::try_pack(char* buffer, const T&... t) const
+{
+   status st = status();
+   size_t index = 0, offset = 0;
+   std::pair<size_t, char> cur(0, 'x');
+   auto packed_items = pack_helper(index, cur, buffer, offset, st, t...);
+   if (st.code == errc())
+   {
+      check_items(packed_items, sizeof...(T), index, cur, st);
+   }
+   return st;
+}
+
+template <typename... T>
+inline std::vector<char> struc::pack(const std::string& pattern, const T&... t)
+{
+   auto s = cache::lookup(pattern);
+   std::vector<char> v(s->calcsize(), '\0');
+   s->pack(v.data(), t...);
+   return v;
+}
+
+template <size_t I, typename... T>
+inline typename std::enable_if<I == sizeof...(T), size_t>::type
+   struc::pack_helper_t(size_t&,
+                        std::pair<size_t, char>&,
+                        char*,
+                        size_t&,
+                        status&,
+                        const std::tuple<T...>&) const
+{
+   return 0;
+}
+
+template <size_t I, typename... T>
+   inline typename std::enable_if
+   < I<sizeof...(T), size_t>::type struc::pack_helper_t(
+        size_t& index,
+        std::pair<size_t, char>& cur,
+        char* buffer,
+        size_t& offset,
+        status& st,
+        const std::tuple<T...>& t) const
+{
+   auto sz = pack_helper(index, cur, buffer, offset, st, std::get<I>(t));
+   sz += pack_helper_t<I + 1, T...>(index, cur, buffer, offset, st, t);
+   return sz;
+}
+
+template <typename... T>
+inline void struc::pack(char* buffer, const std::tuple<T...>& t) const
+{
+   auto st = try_pack(buffer, t);
+   if (st.code != errc())
+   {
+      raise("pack", st);
+   }
+}
+
+template <typename... T>
+inline struc::status struc::try_pack(char* buffer,
+                                     const std::tuple<T...>& t) const
+{
+   status st = status();
+   size_t index = 0, offset = 0;
+   std::pair<size_t, char> cur(0, 'x');
+   auto packed_items = pack_helper_t(index, cur, buffer, offset, st, t);
+   if (st.code == errc())
+   {
+      check_items(packed_items, sizeof...(T), index, cur, st);
+   }
+   return st;
+}
+
+template <typename... T>
+inline std::vector<char> struc::pack(const std::string& pattern,
+                                     const std::tuple<T...>& t)
+{
+   auto s = cache::lookup(pattern);
+   std::vector<char> v(s->calcsize(), '\0');
+   s->pack(v.data(), t);
+   return v;
+}
+
+template <typename F>
+inline typename std::enable_if<std::is_same<F, float>::value, bool>::type
+   struc::unpack_non_ieee(bool little_endian,
+                          const char* buffer,
+                          size_t& offset,
+                          status& st,
+                          F& f)
+{
+   uint8_t sign;
+   int e;
+   uint32_t bits;
+   if (little_endian)
+   {
+      sign = (static_cast<uint8_t>(buffer[offset + 3]) >> 7) & 0x1;
+      e = static_cast<int>((static_cast<uint8_t>(buffer[offset + 3]) & 0x7f)
+                           << 1);
+      e |= (static_cast<uint8_t>(buffer[offset + 2]) >> 7) & 0x1;
+      bits = (static_cast<uint32_t>(buffer[offset + 2]) & 0x7f) << 16;
+   }
+   else
+   {
+      sign = (static_cast<uint8_t>(buffer[offset]) >> 7) & 0x1;
+      e = static_cast<int>((static_cast<uint8_t>(buffer[offset]) & 0x7f) << 1);
+      e |= (static_cast<uint8_t>(buffer[offset + 1]) >> 7) & 0x1;
+      bits = (static_cast<uint32_t>(buffer[offset + 1]) & 0x7f) << 16;
+   }
+   if (e == 255)
+   {
+      return fail(st, errc::ieee_special_value);
+   }
+   if (little_endian)
+   {
+      bits |= static_cast<uint32_t>(buffer[offset + 1]) << 8;
+      bits |= static_cast<uint32_t>(buffer[offset]);
+   }
+   else
+   {
+      bits |= static_cast<uint32_t>(buffer[offset + 2]) << 8;
+      bits |= static_cast<uint32_t>(buffer[offset + 3]);
+   }
+   f = static_cast<double>(bits) / 8388608.0;
+   if (e == 0)
+   {
+      e = -126;
+   }
+   else
+   {
+      f += 1.0;
+      e -= 127;
+   }
+   f = std::ldexp(f, e);
+   if (sign)
+   {
+      f = -f;
+   }
+   offset += 4;
+   return true;
+}
+
+template <typename F>
+inline typename std::enable_if<std::is_same<F, double>::value, bool>::type
+   struc::unpack_non_ieee(bool litte_endian,
+                          const char* buffer,
+                          size_t& offset,
+                          status& st,
+                          F& f)
+{
+   uint8_t sign;
+   int e;
+   uint32_t hi;
+   if (litte_endian)
+   {
+      sign = (static_cast<uint8_t>(buffer[offset + 7]) >> 7) & 0x1;
+      e = static_cast<int>((static_cast<uint32_t>(buffer[offset + 7]) & 0x7f)
+                           << 4);
+      e |= (static_cast<uint8_t>(buffer[offset + 6]) >> 4) & 0xf;
+      hi = (static_cast<uint32_t>(buffer[offset + 6]) & 0xf) << 24;
+   }
+   else
+   {
+      sign = (static_cast<uint8_t>(buffer[offset]) >> 7) & 0x1;
+      e = static_cast<int>((static_cast<uint32_t>(buffer[offset]) & 0x7f) << 4);
+      e |= (static_cast<uint8_t>(buffer[offset + 1]) >> 4) & 0xf;
+      hi = (static_cast<uint32_t>(buffer[offset + 1]) & 0xf) << 24;
+   }
+   if (e == 2047)
+   {
+      return fail(st, errc::ieee_special_value);
+   }
+   uint32_t lo;
+   if (litte_endian)
+   {
+      hi |= static_cast<uint32_t>(buffer[offset + 5]) << 16;
+      hi |= static_cast<uint32_t>(buffer[offset + 4]) << 8;
+      hi |= static_cast<uint32_t>(buffer[offset + 3]);
+      lo = static_cast<uint32_t>(buffer[offset + 2]) << 16;
+      lo |= static_cast<uint32_t>(buffer[offset + 1]) << 8;
+      lo |= static_cast<uint32_t>(buffer[offset]);
+   }
+   else
+   {
+      hi |= static_cast<uint32_t>(buffer[offset + 2]) << 16;
+      hi |= static_cast<uint32_t>(buffer[offset + 3]) << 8;
+      hi |= static_cast<uint32_t>(buffer[offset + 4]);
+      lo = static_cast<uint32_t>(buffer[offset + 5]) << 16;
+      lo |= static_cast<uint32_t>(buffer[offset + 6]) << 8;
+      lo |= static_cast<uint32_t>(buffer[offset + 7]);
+   }
+   f = static_cast<double>(hi) + static_cast<double>(lo) / 16777216.0;
+   f /= 268435456.0;
+   if (e == 0)
+   {
+      e = -1022;
+   }
+   else
+   {
+      f += 1.0;
+      e -= 1023;
+   }
+   f = std::ldexp(f, e);
+   if (sign)
+   {
+      f = -f;
+   }
+   offset += 8;
+   return true;
+}
+
+template <typename F>
+inline typename std::enable_if<!std::is_same<F, float>::value
+                                  && !std::is_same<F, double>::value,
+                               bool>::type
+   struc::unpack_non_ieee(bool, const char*, size_t&, status&, F&)
+{
+   STRUC_THROW(std::runtime_error(
+      "Internal error: Only float or double allowed for ieee unpacking"));
+}
+
+template <typename I, typename T, typename U>
+inline typename std::enable_if<std::is_integral<T>::value, void>::type
+   struc::unpack_native(const char* buffer, size_t& offset, I& i)
+{
+   T i_;
+   std::memcpy(&i_, buffer + offset, sizeof(i_));
+   i = static_cast<I>(i_);
+   offset += sizeof(i_);
+}
+
+template <typename F, typename T, typename U>
+inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+   struc::unpack_native(const char* buffer, size_t& offset, status& st, F& f)
+{
+   T f_;
+   if (is_ieee<T>())
+   {
+      std::memcpy(&f_, buffer + offset, sizeof(f_));
+      f = static_cast<F>(f_);
+      offset += sizeof(f_);
+      return true;
+   }
+   else
+   {
+#ifdef BOOST_BIG_ENDIAN
+      bool ok = unpack_non_ieee<T>(false, buffer, offset, st, f_);
+#else
+      bool ok = unpack_non_ieee<T>(true, buffer, offset, st, f_);
+#endif
+      f = static_cast<F>(f_);
+      return ok;
+   }
+}
+
+template <typename I, typename T, typename U>
+inline typename std::enable_if<std::is_integral<T>::value, void>::type
+   struc::unpack_non_native(control c, const char* buffer, size_t& offset, I& i)
+{
+   T i_;
+   std::memcpy(&i_, buffer + offset, sizeof(i_));
+   from_endian(c, i_);
+   i = static_cast<I>(i_);
+   offset += sizeof(i_);
+}
+
+template <typename F, typename T, typename U>
+inline typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+   struc::unpack_non_native(control c,
+                        const char* buffer,
+                        size_t& offset,
+                        status& st,
+                        F& f)
+{
+   static_assert(sizeof(T) == sizeof(U), "Size of T and U must be equal");
+   T f_;
+   if (is_ieee<T>())
+   {
+      U* i = reinterpret_cast<U*>(&f_);
+      std::memcpy(&f_, buffer + offset, sizeof(f_));
+      from_endian(c, *i);
+      f = static_cast<F>(f_);
+      offset += sizeof(f_);
+      return true;
+   }
+   else
+   {
+      bool ok = unpack_non_ieee<T>(c == litte_endian, buffer, offset, st, f_);
+      f = static_cast<F>(f_);
+      return ok;
+   }
+}
+
+template <typename I>
+inline typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
+   struc::unpack_scalar(control c,
+                        std::pair<size_t, char>& cur,
+                        const char* buffer,
+                        size_t& offset,
+                        status& st,
+                        I& i)
+{
+   bool ok = true;
+   switch (cur.second)
+   {
+   case 'c':
+   case 'b':
+   case 'B':
+   case '?':
+      std::memcpy(&i, buffer + offset, 1);
+      offset += 1;
+      break;
+   case 'h':
+      c == native ? unpack_native<I, short>(buffer, offset, i) :
+                    unpack_non_native<I, int16_t>(c, buffer, offset, i);
+      break;
+   case 'H':
+      c == native ? unpack_native<I, unsigned short>(buffer, offset, i) :
+                    unpack_non_native<I, uint16_t>(c, buffer, offset, i);
+      break;
+   case 'i':
+      c == native ? unpack_native<I, int>(buffer, offset, i) :
+                    unpack_non_native<I, int32_t>(c, buffer, offset, i);
+      break;
+   case 'I':
+      c == native ? unpack_native<I, unsigned int>(buffer, offset, i) :
+                    unpack_non_native<I, uint32_t>(c, buffer, offset, i);
+      break;
+   case 'l':
+      c == native ? unpack_native<I, long>(buffer, offset, i) :
+                    unpack_non_native<I, int32_t>(c, buffer, offset, i);
+      break;
+   case 'L':
+      c == native ? unpack_native<I, unsigned long>(buffer, offset, i) :
+                    unpack_non_native<I, uint32_t>(c, buffer, offset, i);
+      break;
+   case 'q':
+      c == native ? unpack_native<I, long long>(buffer, offset, i) :
+                    unpack_non_native<I, int64_t>(c, buffer, offset, i);
+      break;
+   case 'Q':
+      c == native ? unpack_native<I, unsigned long long>(buffer, offset, i) :
+                    unpack_non_native<I, uint64_t>(c, buffer, offset, i);
+      break;
+   case 'f':
+      ok = c == native ?
+         unpack_native<I, float>(buffer, offset, st, i) :
+         unpack_non_native<I, float, uint32_t>(c, buffer, offset, st, i);
+      break;
+   case 'd':
+      ok = c == native ?
+         unpack_native<I, double>(buffer, offset, st, i) :
+         unpack_non_native<I, double, uint64_t>(c, buffer, offset, st, i);
+      break;
+   default:
+      return fail(st, errc::illegal_type);
+   }
+   if (!ok)
+   {
+      return false;
+   }
+   cur.first--;
+   return true;
+}
+
+template <typename A>
+inline
+   typename std::enable_if<std::is_array<A>::value
+                              && !std::is_constructible<std::string, A>::value,
+                           bool>::type
+   struc::unpack_scalar(control c,
+                        std::pair<size_t, char>& cur,
+                        const char* buffer,
+                        size_t& offset,
+                        status& st,
+                        A& a)
+{
+   return unpack_array(
+      c, cur, buffer, offset, st, &a[0], std::extent<A>::value);
+}
+
+template <typename T, size_t N>
+inline bool struc::unpack_scalar(control c,
+                                 std::pair<size_t, char>& cur,
+                                 const char* buffer,
+                                 size_t& offset,
+                                 status& st,
+                                 std::array<T, N>& a)
+{
+   return unpack_array(c, cur, buffer, offset, st, a.data(), N);
+}
+
+template <typename T, typename A>
+inline bool struc::unpack_scalar(control c,
+                                 std::pair<size_t, char>& cur,
+                                 const char* buffer,
+                                 size_t& offset,
+                                 status& st,
+                                 std::vector<T, A>& v)
+{
+   // sized once for the whole run
+   v.resize(cur.first);
+   return unpack_array(c, cur, buffer, offset, st, v.data(), v.size());
+}
+
+template <typename T>
+inline bool struc::unpack_scalar(control c,
+                                 std::pair<size_t, char>& cur,
+                                 const char* buffer,
+                                 size_t& offset,
+                                 status& st,
+                                 const span<T>& s)
+{
+   return unpack_array(c, cur, buffer, offset, st, s.data(), s.size());
+}
+
+template <typename E>
+inline bool struc::unpack_array(control c,
+                                std::pair<size_t, char>& cur,
+                                const char* buffer,
+                                size_t& offset,
+                                status& st,
+                                E* e,
+                                size_t n)
+{
+   if (n < cur.first)
+   {
+      return fail(st, errc::array_too_small, cur.first, n);
+   }
+   else if (n > cur.first)
+   {
+      return fail(st, errc::array_too_large, cur.first, n);
+   }
+   if (std::is_arithmetic<E>::value && is_run<E>(c, cur.second))
+   {
+      std::memcpy(e, buffer + offset, n * sizeof(E));
+      if (needs_swap(c))
+      {
+         swap_bytes(reinterpret_cast<char*>(e), n, sizeof(E));
+      }
+      offset += n * sizeof(E);
+      cur.first -= n;
+      return true;
+   }
+   for (size_t i = 0; i < n; ++i)
+   {
+      if (!unpack_scalar(c, cur, buffer, offset, st, e[i]))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+template <typename S>
+inline typename std::enable_if<std::is_same<std::string, S>::value, bool>::type
+   struc::unpack_scalar(control,
+                        std::pair<size_t, char>& cur,
+                        const char* buffer,
+                        size_t& offset,
+                        status& st,
+                        S& s)
+{
+   switch (cur.second)
+   {
+   case 's':
+   case 'p':
+   {
+      size_t sz = s.size();
+      s = std::string(buffer + offset, sz);
+      offset += sz;
+      cur.first--;
+      break;
+   }
+   default:
+      return fail(st, errc::illegal_type);
+   }
+   return true;
+}
+
+template <typename S>
+inline typename std::enable_if<std::is_constructible<std::string, S>::value
+                                  && !std::is_null_pointer<S>::value
+                                  && !std::is_same<std::string, S>::value,
+                               bool>::type
+   struc::unpack_scalar(control c,
+                        std::pair<size_t, char>& cur,
+                        const char* buffer,
+                        size_t& offset,
+                        status& st,
+                        S& s)
+{
+   switch (cur.second)
+   {
+   case 's':
+   case 'p':
+   {
+      size_t sz = strlen(s);
+      std::memcpy(s, buffer + offset, sz);
+      offset += sz;
+      cur.first--;
+      break;
+   }
+   case 'c':
+   {
+      if (!std::is_array<S>::value)
+      {
+         return fail(st, errc::expected_char_array);
+      }
+      if (std::extent<S>::value < cur.first)
+      {
+         return fail(
+            st, errc::array_too_small, cur.first, std::extent<S>::value);
+      }
+      else if (std::extent<S>::value > cur.first)
+      {
+         return fail(
+            st, errc::array_too_large, cur.first, std::extent<S>::value);
+      }
+      for (size_t i = 0; i < std::extent<S>::value; ++i)
+      {
+         if (!unpack_scalar(c, cur, buffer, offset, st, s[i]))
+         {
+            return false;
+         }
+      }
+      break;
+   }
+   default:
+      return fail(st, errc::illegal_type);
+   }
+   return true;
+}
+
+template <typename P>
+inline
+   typename std::enable_if<(std::is_pointer<P>::value
+                            && !std::is_constructible<std::string, P>::value)
+                              || std::is_member_pointer<P>::value,
+                           bool>::type
+   struc::unpack_scalar(control,
+                        std::pair<size_t, char>& cur,
+                        const char* buffer,
+                        size_t& offset,
+                        status& st,
+                        P& p)
+{
+   // the constructor only accepts P with native byte order
+   if (cur.second != 'P')
+   {
+      return fail(st, errc::illegal_type);
+   }
+   void* p_;
+   std::memcpy(&p_, buffer + offset, sizeof(p_));
+   p = static_cast<P>(p_);
+   offset += sizeof(p_);
+   cur.first--;
+   return true;
+}
+
+template <typename T>
+inline size_t struc::unpack_helper(size_t& index,
+                                   std::pair<size_t, char>& cur,
+                                   const char* buffer,
+                                   size_t& offset,
+                                   status& st,
+                                   T& t) const
+{
+   if (st.code != errc())
+   {
+      return 0;
+   }
+   if (cur.first == 0)
+   {
+      if (index == fields.size())
+      {
+         return 0;
+      }
+      const auto& f = fields[index++];
+      cur.first = f.count;
+      cur.second = f.type;
+      offset = f.offset;
+      if (f.type == 's' || f.type == 'p')
+      {
+         prep_scalar(f.size, t);
+      }
+   }
+   if (!unpack_scalar(c, cur, buffer, offset, st, t))
+   {
+      const auto& f = fields[index - 1];
+      st.index = f.item + f.count - cur.first;
+      return 0;
+   }
+   return 1;
+}
+
+template <typename T, typename... Ts>
+inline size_t struc::unpack_helper(size_t& index,
+                                   std::pair<size_t, char>& cur,
+                                   const char* buffer,
+                                   size_t& offset,
+                                   status& st,
+                                   T& t,
+                                   Ts&... ts) const
+{
+   auto sz = unpack_helper(index, cur, buffer, offset, st, t);
+   sz += unpack_helper(index, cur, buffer, offset, st, ts...);
+   return sz;
+}
+
+template <typename... T>
+inline void struc::unpack(const char* buffer, T&... t) const
+{
+   auto st = try_unpack(buffer, t...);
+   if (st.code != errc())
+   {
+      raise("unpack", st);
+   }
+}
+
+template <typename... T>
+inline struc::status struc::try_unpack(const char* buffer, T&... t) const
+{
+   status st = status();
+   size_t index = 0, offset = 0;
+   std::pair<size_t, char> cur(0, 'x');
+   auto unpacked_items = unpack_helper(index, cur, buffer, offset, st, t...);
+   if (st.code == errc())
+   {
+      check_items(unpacked_items, sizeof...(T), index, cur, st);
+   }
+   return st;
+}
+
+template <typename... T>
+inline void struc::unpack(const std::string& pattern,
+                          const char* buffer,
+                          T&... t)
+{
+   cache::lookup(pattern)->unpack(buffer, t...);
+}
+
+template <size_t I, typename... T>
+inline typename std::enable_if<I == sizeof...(T), size_t>::type
+   struc::unpack_helper_t(size_t&,
+                          std::pair<size_t, char>&,
+                          const char*,
+                          size_t&,
+                          status&,
+                          std::tuple<T...>&) const
+{
+   return 0;
+}
+
+template <size_t I, typename... T>
+   inline typename std::enable_if
+   < I<sizeof...(T), size_t>::type struc::unpack_helper_t(
+        size_t& index,
+        std::pair<size_t, char>& cur,
+        const char* buffer,
+        size_t& offset,
+        status& st,
+        std::tuple<T...>& t) const
+{
+   auto sz = unpack_helper(index, cur, buffer, offset, st, std::get<I>(t));
+   sz += unpack_helper_t<I + 1, T...>(index, cur, buffer, offset, st, t);
+   return sz;
+}
+
+template <typename... T>
+inline void struc::unpack(const char* buffer, std::tuple<T...>& t) const
+{
+   auto st = try_unpack(buffer, t);
+   if (st.code != errc())
+   {
+      raise("unpack", st);
+   }
+}
+
+template <typename... T>
+inline struc::status struc::try_unpack(const char* buffer,
+                                       std::tuple<T...>& t) const
+{
+   status st = status();
+   size_t index = 0, offset = 0;
+   std::pair<size_t, char> cur(0, 'x');
+   auto unpacked_items = unpack_helper_t(index, cur, buffer, offset, st, t);
+   if (st.code == errc())
+   {
+      check_items(unpacked_items, sizeof...(T), index, cur, st);
+   }
+   return st;
+}
+
+template <typename... T>
+inline void struc::unpack(const std::string& pattern,
+                          const char* buffer,
+                          std::tuple<T...>& t)
+{
+   cache::lookup(pattern)->unpack(buffer, t);
+}
+
+inline struc::struc(const std::string& pattern)
+: c(native)
+, size(0)
+, record_stride(0)
+{
+   status st = status();
+   char type = 'x';
+   if (!compile(pattern, st, type))
+   {
+      if (type == 'P')
+      {
+         STRUC_THROW(std::logic_error(
+            "native byte order is required for the P format"));
+      }
+      raise("struc", st, type);
+   }
+}
+
+inline struc::struc(const std::string& pattern, status& st)
+: c(native)
+, size(0)
+, record_stride(0)
+{
+   char type;
+   compile(pattern, st, type);
+}
+
+inline struc::status struc::try_compile(const std::string& pattern,
+                                        std::unique_ptr<struc>& s)
+{
+   status st = status();
+   s.reset(new struc(pattern, st));
+   if (st.code != errc())
+   {
+      s.reset();
+   }
+   return st;
+}
+
+inline bool struc::compile(const std::string& pattern,
+                           status& st,
+                           char& type_)
+{
+   size_t pos = 0, items = 0, alignment = 1;
+   if (pattern.find_first_of("@=<>!") == 0)
+   {
+      switch (pattern[0])
+      {
+      case '@':
+         c = native;
+         break;
+      case '=':
+         c = standard;
+         break;
+      case '<':
+         c = litte_endian;
+         break;
+      case '>':
+      case '!':
+         c = big_endian;
+         break;
+      default:
+         break;
+      }
+      pos = 1;
+   }
+   std::string n;
+   while (pos < pattern.size())
+   {
+      char type = pattern[pos++];
+      if (std::isspace(type))
+      {
+         continue;
+      }
+      if (std::isdigit(type))
+      {
+         n += type;
+         continue;
+      }
+      size_t num = 1;
+      if (n.size() > 0)
+      {
+         num = 0;
+         for (char d : n)
+         {
+            if (num > (std::numeric_limits<size_t>::max() - 9) / 10)
+            {
+               num = 1;
+               break;
+            }
+            num = num * 10 + static_cast<size_t>(d - '0');
+         }
+         n.clear();
+      }
+      size_t sz;
+      size_t pad = c == native ? native_padding(size, type) : 0;
+      switch (type)
+      {
+      case 'h':
+         sz = c == native ? sizeof(short) : sizeof(int16_t);
+         break;
+      case 'H':
+         sz = c == native ? sizeof(unsigned short) : sizeof(int16_t);
+         break;
+      case 'i':
+         sz = c == native ? sizeof(int) : sizeof(int32_t);
+         break;
+      case 'I':
+         sz = c == native ? sizeof(unsigned int) : sizeof(int32_t);
+         break;
+      case 'l':
+         sz = c == native ? sizeof(long) : sizeof(int32_t);
+         break;
+      case 'L':
+         sz = c == native ? sizeof(unsigned long) : sizeof(int32_t);
+         break;
+      case 'q':
+         sz = c == native ? sizeof(long long) : sizeof(int64_t);
+         break;
+      case 'Q':
+         sz = c == native ? sizeof(unsigned long long) : sizeof(int64_t);
+         break;
+      case 'f':
+         sz = sizeof(float);
+         break;
+      case 'd':
+         sz = sizeof(double);
+         break;
+      case 'P':
+         if (c != native)
+         {
+            type_ = type;
+            st.index = items;
+            return fail(st, errc::illegal_type);
+         }
+         sz = sizeof(void*);
+         break;
+      case 'x':
+      case 'c':
+      case 'b':
+      case 'B':
+      case '?':
+         sz = 1;
+         break;
+      case 's':
+      case 'p':
+         sz = num;
+         num = 1;
+         break;
+      default:
+         type_ = type;
+         st.index = items;
+         return fail(st, errc::illegal_type);
+      }
+      size += pad;
+      if (type != 'x' && num > 0)
+      {
+         field f = {type, num, size, sz, items};
+         fields.push_back(f);
+         items += num;
+         if (c == native)
+         {
+            alignment = std::max(alignment, native_alignment(type));
+         }
+      }
+      size += sz * num;
+   }
+   record_stride = (size + alignment - 1) / alignment * alignment;
+   return true;
+}
+
+inline size_t struc::missing_items(size_t index,
+                                   const std::pair<size_t, char>& cur) const
+{
+   size_t no_of_items = cur.first;
+   for (; index < fields.size(); ++index)
+   {
+      no_of_items += fields[index].count;
+   }
+   return no_of_items;
+}
+
+inline bool struc::check_items(size_t items,
+                               size_t no_of_args,
+                               size_t index,
+                               const std::pair<size_t, char>& cur,
+                               status& st) const
+{
+   if (items < no_of_args)
+   {
+      st.index = no_of_items();
+      return fail(st, errc::extra_arguments, items, no_of_args);
+   }
+   auto missing = missing_items(index, cur);
+   if (missing > 0)
+   {
+      st.index = no_of_items() - missing;
+      return fail(st, errc::missing_arguments, no_of_items(), st.index);
+   }
+   return true;
+}
+
+inline size_t struc::no_of_items() const
+{
+   return fields.empty() ? 0 : fields.back().item + fields.back().count;
+}
+
+inline const struc::field* struc::item_field(size_t index,
+                                            size_t& offset) const
+{
+   auto it = std::upper_bound(
+      fields.begin(), fields.end(), index, [](size_t i, const field& f) {
+         return i < f.item;
+      });
+   if (it == fields.begin() || index >= (it - 1)->item + (it - 1)->count)
+   {
+      return nullptr;
+   }
+   --it;
+   offset = it->offset + (index - it->item) * it->size;
+   return &*it;
+}
+
+inline bool struc::fail(status& st, errc e, size_t expected, size_t actual)
+{
+   st.code = e;
+   st.expected = expected;
+   st.actual = actual;
+   return false;
+}
+
+inline void struc::raise(const char* what, const status& st, char type)
+{
+   switch (st.code)
+   {
+   case errc::extra_arguments:
+      STRUC_THROW(std::overflow_error(std::string("Extra ")
+                                      + std::to_string(st.actual - st.expected)
+                                      + " arguments to " + what));
+   case errc::missing_arguments:
+      STRUC_THROW(std::underflow_error(
+         std::string("Missing ") + std::to_string(st.expected - st.actual)
+         + " arguments to " + what));
+   case errc::illegal_type:
+      STRUC_THROW(
+         std::logic_error(std::string("Encountered illegal type: ") + type));
+   case errc::expected_char_array:
+      STRUC_THROW(std::logic_error("Expected array of char"));
+   case errc::wrong_string_length:
+      STRUC_THROW(std::logic_error(std::string("String has wrong length ")
+                                   + std::to_string(st.actual)
+                                   + ", expected "
+                                   + std::to_string(st.expected)));
+   case errc::array_too_small:
+      STRUC_THROW(std::underflow_error(
+         std::string("Provided array too small (") + std::to_string(st.actual)
+         + "), expected " + std::to_string(st.expected)));
+   case errc::array_too_large:
+      STRUC_THROW(std::overflow_error(
+         std::string("Provided array too large (") + std::to_string(st.actual)
+         + "), expected " + std::to_string(st.expected)));
+   case errc::too_large_for_ieee:
+      STRUC_THROW(std::overflow_error(
+         std::string(type == 'f' ? "float" : "double")
+         + " is too large to pack into ieee format"));
+   case errc::frexp_out_of_range:
+      STRUC_THROW(std::runtime_error("frexp() result is out of range"));
+   case errc::ieee_special_value:
+      STRUC_THROW(std::runtime_error("Can't unpack ieee special value"));
+   case errc::buffer_too_small:
+      STRUC_THROW(std::out_of_range(
+         std::string(what) + " requires a buffer of at least "
+         + std::to_string(st.expected) + " bytes (actual buffer size is "
+         + std::to_string(st.actual) + ")"));
+   case errc::index_out_of_range:
+      STRUC_THROW(std::out_of_range(std::string("Item index out of range: ")
+                                    + std::to_string(st.index)));
+   case errc::partial_record:
+      STRUC_THROW(std::out_of_range(
+         st.expected == 0 ?
+            std::string(what) + " requires a pattern of non-zero size" :
+            std::string(what) + " requires a buffer of a multiple of "
+               + std::to_string(st.expected) + " bytes"));
+   }
+   STRUC_THROW(std::runtime_error("Internal error: raise without an error"));
+}
+
+inline void struc::raise(const char* what, const status& st) const
+{
+   if (st.code == errc::buffer_too_small)
+   {
+      auto offset = st.expected - size;
+      STRUC_THROW(std::out_of_range(
+         std::string(what) + " requires a buffer of at least "
+         + std::to_string(st.expected) + " bytes for " + std::to_string(size)
+         + " bytes at offset " + std::to_string(offset)
+         + " (actual buffer size is " + std::to_string(st.actual) + ")"));
+   }
+   size_t offset;
+   auto f = item_field(st.index, offset);
+   raise(what, st, f ? f->type : 'x');
+}
+
+class struc::error_category : public std::error_category
+{
+public:
+   const char* name() const noexcept override
+   {
+      return "struc";
+   }
+
+   std::string message(int e) const override
+   {
+      switch (static_cast<errc>(e))
+      {
+      case errc::extra_arguments:
+         return "extra arguments";
+      case errc::missing_arguments:
+         return "missing arguments";
+      case errc::illegal_type:
+         return "illegal type";
+      case errc::expected_char_array:
+         return "expected array of char";
+      case errc::wrong_string_length:
+         return "string has wrong length";
+      case errc::array_too_small:
+         return "provided array too small";
+      case errc::array_too_large:
+         return "provided array too large";
+      case errc::too_large_for_ieee:
+         return "too large to pack into ieee format";
+      case errc::frexp_out_of_range:
+         return "frexp() result is out of range";
+      case errc::ieee_special_value:
+         return "can't unpack ieee special value";
+      case errc::buffer_too_small:
+         return "buffer too small";
+      case errc::index_out_of_range:
+         return "item index out of range";
+      case errc::partial_record:
+         return "buffer ends in a partial record";
+      }
+      return "unknown error";
+   }
+};
+
+inline const std::error_category& struc::category()
+{
+   static error_category c;
+   return c;
+}
+
+inline std::error_code struc::status::error() const
+{
+   return make_error_code(code);
+}
+
+inline std::error_code make_error_code(struc::errc e)
+{
+   return std::error_code(static_cast<int>(e), struc::category());
+}
+
+template <typename T>
+inline void struc::pack_field(char* buffer, size_t index, const T& t) const
+{
+   auto st = try_pack_field(buffer, index, t);
+   if (st.code != errc())
+   {
+      raise("pack_field", st);
+   }
+}
+
+template <typename T>
+inline struc::status struc::try_pack_field(char* buffer,
+                                           size_t index,
+                                           const T& t) const
+{
+   status st = status();
+   st.index = index;
+   size_t offset;
+   auto f = item_field(index, offset);
+   if (!f)
+   {
+      fail(st, errc::index_out_of_range);
+      return st;
+   }
+   std::pair<size_t, char> cur(1, f->type);
+   if (f->type == 's' || f->type == 'p')
+   {
+      if (!check_scalar(f->size, t, st))
+      {
+         return st;
+      }
+   }
+   pack_scalar(c, cur, buffer, offset, st, t);
+   return st;
+}
+
+template <typename T>
+inline void struc::unpack_field(const char* buffer, size_t index, T& t) const
+{
+   auto st = try_unpack_field(buffer, index, t);
+   if (st.code != errc())
+   {
+      raise("unpack_field", st);
+   }
+}
+
+template <typename T>
+inline struc::status struc::try_unpack_field(const char* buffer,
+                                             size_t index,
+                                             T& t) const
+{
+   status st = status();
+   st.index = index;
+   size_t offset;
+   auto f = item_field(index, offset);
+   if (!f)
+   {
+      fail(st, errc::index_out_of_range);
+      return st;
+   }
+   std::pair<size_t, char> cur(1, f->type);
+   if (f->type == 's' || f->type == 'p')
+   {
+      prep_scalar(f->size, t);
+   }
+   unpack_scalar(c, cur, buffer, offset, st, t);
+   return st;
+}
+
+inline bool struc::check_length(size_t length,
+                                size_t offset,
+                                status& st) const
+{
+   if (offset > length || length - offset < size)
+   {
+      return fail(st, errc::buffer_too_small, offset + size, length);
+   }
+   return true;
+}
+
+template <typename... T>
+inline size_t struc::pack_into(char* buffer,
+                               size_t length,
+                               size_t offset,
+                               const T&... t) const
+{
+   auto st = try_pack_into(buffer, length, offset, t...);
+   if (st.code != errc())
+   {
+      raise("pack_into", st);
+   }
+   return offset + size;
+}
+
+template <typename... T>
+inline struc::status struc::try_pack_into(char* buffer,
+                                          size_t length,
+                                          size_t offset,
+                                          const T&... t) const
+{
+   status st = status();
+   if (!check_length(length, offset, st))
+   {
+      return st;
+   }
+   return try_pack(buffer + offset, t...);
+}
+
+template <typename... T>
+inline size_t struc::pack_into(char* buffer,
+                               size_t length,
+                               size_t offset,
+                               const std::tuple<T...>& t) const
+{
+   auto st = try_pack_into(buffer, length, offset, t);
+   if (st.code != errc())
+   {
+      raise("pack_into", st);
+   }
+   return offset + size;
+}
+
+template <typename... T>
+inline struc::status struc::try_pack_into(char* buffer,
+                                          size_t length,
+                                          size_t offset,
+                                          const std::tuple<T...>& t) const
+{
+   status st = status();
+   if (!check_length(length, offset, st))
+   {
+      return st;
+   }
+   return try_pack(buffer + offset, t);
+}
+
+template <typename... T>
+inline size_t struc::pack_into(const std::string& pattern,
+                               char* buffer,
+                               size_t length,
+                               size_t offset,
+                               const T&... t)
+{
+   return cache::lookup(pattern)->pack_into(buffer, length, offset, t...);
+}
+
+template <typename... T>
+inline size_t struc::pack_into(const std::string& pattern,
+                               char* buffer,
+                               size_t length,
+                               size_t offset,
+                               const std::tuple<T...>& t)
+{
+   return cache::lookup(pattern)->pack_into(buffer, length, offset, t);
+}
+
+template <typename... T>
+inline size_t struc::unpack_from(const char* buffer,
+                                 size_t length,
+                                 size_t offset,
+                                 T&... t) const
+{
+   auto st = try_unpack_from(buffer, length, offset, t...);
+   if (st.code != errc())
+   {
+      raise("unpack_from", st);
+   }
+   return offset + size;
+}
+
+template <typename... T>
+inline struc::status struc::try_unpack_from(const char* buffer,
+                                            size_t length,
+                                            size_t offset,
+                                            T&... t) const
+{
+   status st = status();
+   if (!check_length(length, offset, st))
+   {
+      return st;
+   }
+   return try_unpack(buffer + offset, t...);
+}
+
+template <typename... T>
+inline size_t struc::unpack_from(const char* buffer,
+                                 size_t length,
+                                 size_t offset,
+                                 std::tuple<T...>& t) const
+{
+   auto st = try_unpack_from(buffer, length, offset, t);
+   if (st.code != errc())
+   {
+      raise("unpack_from", st);
+   }
+   return offset + size;
+}
+
+template <typename... T>
+inline struc::status struc::try_unpack_from(const char* buffer,
+                                            size_t length,
+                                            size_t offset,
+                                            std::tuple<T...>& t) const
+{
+   status st = status();
+   if (!check_length(length, offset, st))
+   {
+      return st;
+   }
+   return try_unpack(buffer + offset, t);
+}
+
+template <typename... T>
+inline size_t struc::unpack_from(const std::string& pattern,
+                                 const char* buffer,
+                                 size_t length,
+                                 size_t offset,
+                                 T&... t)
+{
+   return cache::lookup(pattern)->unpack_from(buffer, length, offset, t...);
+}
+
+template <typename... T>
+inline size_t struc::unpack_from(const std::string& pattern,
+                                 const char* buffer,
+                                 size_t length,
+                                 size_t offset,
+                                 std::tuple<T...>& t)
+{
+   return cache::lookup(pattern)->unpack_from(buffer, length, offset, t);
+}
+
+template <typename... T>
+inline void struc::unpack_columns(const char* buffer,
+                                  size_t n,
+                                  T&&... columns) const
+{
+   auto st = try_unpack_columns(buffer, n, columns...);
+   if (st.code != errc())
+   {
+      raise("unpack_columns", st);
+   }
+}
+
+template <typename... T>
+inline struc::status struc::try_unpack_columns(const char* buffer,
+                                               size_t n,
+                                               T&&... columns) const
+{
+   status st = status();
+   if (check_columns(sizeof...(T), st))
+   {
+      unpack_columns_helper(0, buffer, n, st, columns...);
+   }
+   return st;
+}
+
+inline bool struc::check_columns(size_t columns, status& st) const
+{
+   auto items = no_of_items();
+   st.index = std::min(columns, items);
+   if (columns > items)
+   {
+      return fail(st, errc::extra_arguments, items, columns);
+   }
+   if (columns < items)
+   {
+      return fail(st, errc::missing_arguments, items, columns);
+   }
+   return true;
+}
+
+template <typename T>
+inline T* struc::column_data(T* t, size_t)
+{
+   return t;
+}
+
+template <typename T>
+inline T* struc::column_data(std::vector<T>& v, size_t n)
+{
+   v.resize(n);
+   return v.data();
+}
+
+inline bool struc::unpack_columns_helper(size_t,
+                                         const char*,
+                                         size_t,
+                                         status&) const
+{
+   return true;
+}
+
+template <typename T, typename... Ts>
+inline bool struc::unpack_columns_helper(size_t index,
+                                         const char* buffer,
+                                         size_t n,
+                                         status& st,
+                                         T&& column,
+                                         Ts&&... columns) const
+{
+   size_t offset;
+   auto f = item_field(index, offset);
+   if (!f)
+   {
+      st.index = index;
+      return fail(st, errc::index_out_of_range);
+   }
+   if (!unpack_column(*f, buffer + offset, n, st, column_data(column, n)))
+   {
+      st.index = index;
+      return false;
+   }
+   return unpack_columns_helper(index + 1, buffer, n, st, columns...);
+}
+
+template <typename I>
+inline typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
+   struc::unpack_column(const field& f,
+                        const char* buffer,
+                        size_t n,
+                        status& st,
+                        I* i) const
+{
+   // the type is dispatched once per column, not once per record
+   switch (f.type)
+   {
+   case 'h':
+      c == native ? unpack_native_column<I, short>(buffer, n, i) :
+                    unpack_non_native_column<I, int16_t>(buffer, n, i);
+      break;
+   case 'H':
+      c == native ? unpack_native_column<I, unsigned short>(buffer, n, i) :
+                    unpack_non_native_column<I, uint16_t>(buffer, n, i);
+      break;
+   case 'i':
+      c == native ? unpack_native_column<I, int>(buffer, n, i) :
+                    unpack_non_native_column<I, int32_t>(buffer, n, i);
+      break;
+   case 'I':
+      c == native ? unpack_native_column<I, unsigned int>(buffer, n, i) :
+                    unpack_non_native_column<I, uint32_t>(buffer, n, i);
+      break;
+   case 'l':
+      c == native ? unpack_native_column<I, long>(buffer, n, i) :
+                    unpack_non_native_column<I, int32_t>(buffer, n, i);
+      break;
+   case 'L':
+      c == native ? unpack_native_column<I, unsigned long>(buffer, n, i) :
+                    unpack_non_native_column<I, uint32_t>(buffer, n, i);
+      break;
+   case 'q':
+      c == native ? unpack_native_column<I, long long>(buffer, n, i) :
+                    unpack_non_native_column<I, int64_t>(buffer, n, i);
+      break;
+   case 'Q':
+      c == native ?
+         unpack_native_column<I, unsigned long long>(buffer, n, i) :
+         unpack_non_native_column<I, uint64_t>(buffer, n, i);
+      break;
+   case 'f':
+      if (!is_ieee<float>())
+      {
+         return unpack_each(f, buffer, n, st, i);
+      }
+      c == native ?
+         unpack_native_column<I, float>(buffer, n, i) :
+         unpack_non_native_column<I, float, uint32_t>(buffer, n, i);
+      break;
+   case 'd':
+      if (!is_ieee<double>())
+      {
+         return unpack_each(f, buffer, n, st, i);
+      }
+      c == native ?
+         unpack_native_column<I, double>(buffer, n, i) :
+         unpack_non_native_column<I, double, uint64_t>(buffer, n, i);
+      break;
+   default:
+      return unpack_each(f, buffer, n, st, i);
+   }
+   return true;
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type
+   struc::unpack_column(const field& f,
+                        const char* buffer,
+                        size_t n,
+                        status& st,
+                        T* t) const
+{
+   return unpack_each(f, buffer, n, st, t);
+}
+
+template <typename T>
+inline bool struc::unpack_each(const field& f,
+                               const char* buffer,
+                               size_t n,
+                               status& st,
+                               T* t) const
+{
+   for (size_t k = 0; k < n; ++k)
+   {
+      std::pair<size_t, char> cur(1, f.type);
+      size_t offset = k * record_stride;
+      if (f.type == 's' || f.type == 'p')
+      {
+         prep_scalar(f.size, t[k]);
+      }
+      if (!unpack_scalar(c, cur, buffer, offset, st, t[k]))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+template <typename I, typename T>
+inline void struc::unpack_native_column(const char* buffer,
+                                        size_t n,
+                                        I* i) const
+{
+   for (size_t k = 0; k < n; ++k, buffer += record_stride)
+   {
+      T t;
+      std::memcpy(&t, buffer, sizeof(t));
+      i[k] = static_cast<I>(t);
+   }
+}
+
+template <typename I, typename T, typename U>
+inline void struc::unpack_non_native_column(const char* buffer,
+                                            size_t n,
+                                            I* i) const
+{
+   static_assert(sizeof(T) == sizeof(U), "Size of T and U must be equal");
+   for (size_t k = 0; k < n; ++k, buffer += record_stride)
+   {
+      U u;
+      std::memcpy(&u, buffer, sizeof(u));
+      from_endian(c, u);
+      T t;
+      std::memcpy(&t, &u, sizeof(t));
+      i[k] = static_cast<I>(t);
+   }
+}
+
+template <typename... T>
+inline void struc::pack_columns(char* buffer,
+                                size_t n,
+                                const T&... columns) const
+{
+   auto st = try_pack_columns(buffer, n, columns...);
+   if (st.code != errc())
+   {
+      raise("pack_columns", st);
+   }
+}
+
+template <typename... T>
+inline struc::status struc::try_pack_columns(char* buffer,
+                                             size_t n,
+                                             const T&... columns) const
+{
+   status st = status();
+   if (check_columns(sizeof...(T), st))
+   {
+      pack_columns_helper(0, buffer, n, st, columns...);
+   }
+   return st;
+}
+
+template <typename T>
+inline const T* struc::column_data(const std::vector<T>& v, size_t)
+{
+   return v.data();
+}
+
+template <typename T>
+inline size_t struc::column_length(const T*)
+{
+   return std::numeric_limits<size_t>::max();
+}
+
+template <typename T>
+inline size_t struc::column_length(const std::vector<T>& v)
+{
+   return v.size();
+}
+
+inline bool struc::pack_columns_helper(size_t, char*, size_t, status&) const
+{
+   return true;
+}
+
+template <typename T, typename... Ts>
+inline bool struc::pack_columns_helper(size_t index,
+                                       char* buffer,
+                                       size_t n,
+                                       status& st,
+                                       const T& column,
+                                       const Ts&... columns) const
+{
+   size_t offset;
+   auto f = item_field(index, offset);
+   if (!f)
+   {
+      st.index = index;
+      return fail(st, errc::index_out_of_range);
+   }
+   if (column_length(column) < n)
+   {
+      st.index = index;
+      return fail(st, errc::array_too_small, n, column_length(column));
+   }
+   if (!pack_column(*f, buffer + offset, n, st, column_data(column, n)))
+   {
+      st.index = index;
+      return false;
+   }
+   return pack_columns_helper(index + 1, buffer, n, st, columns...);
+}
+
+template <typename I>
+inline typename std::enable_if<std::is_arithmetic<I>::value, bool>::type
+   struc::pack_column(const field& f,
+                      char* buffer,
+                      size_t n,
+                      status& st,
+                      const I* i) const
+{
+   // the type is dispatched once per column, not once per record
+   switch (f.type)
+   {
+   case 'h':
+      c == native ? pack_native_column<I, short>(buffer, n, i) :
+                    pack_non_native_column<I, int16_t>(buffer, n, i);
+      break;
+   case 'H':
+      c == native ? pack_native_column<I, unsigned short>(buffer, n, i) :
+                    pack_non_native_column<I, uint16_t>(buffer, n, i);
+      break;
+   case 'i':
+      c == native ? pack_native_column<I, int>(buffer, n, i) :
+                    pack_non_native_column<I, int32_t>(buffer, n, i);
+      break;
+   case 'I':
+      c == native ? pack_native_column<I, unsigned int>(buffer, n, i) :
+                    pack_non_native_column<I, uint32_t>(buffer, n, i);
+      break;
+   case 'l':
+      c == native ? pack_native_column<I, long>(buffer, n, i) :
+                    pack_non_native_column<I, int32_t>(buffer, n, i);
+      break;
+   case 'L':
+      c == native ? pack_native_column<I, unsigned long>(buffer, n, i) :
+                    pack_non_native_column<I, uint32_t>(buffer, n, i);
+      break;
+   case 'q':
+      c == native ? pack_native_column<I, long long>(buffer, n, i) :
+                    pack_non_native_column<I, int64_t>(buffer, n, i);
+      break;
+   case 'Q':
+      c == native ? pack_native_column<I, unsigned long long>(buffer, n, i) :
+                    pack_non_native_column<I, uint64_t>(buffer, n, i);
+      break;
+   case 'f':
+      if (!is_ieee<float>())
+      {
+         return pack_each(f, buffer, n, st, i);
+      }
+      c == native ? pack_native_column<I, float>(buffer, n, i) :
+                    pack_non_native_column<I, float, uint32_t>(buffer, n, i);
+      break;
+   case 'd':
+      if (!is_ieee<double>())
+      {
+         return pack_each(f, buffer, n, st, i);
+      }
+      c == native ?
+         pack_native_column<I, double>(buffer, n, i) :
+         pack_non_native_column<I, double, uint64_t>(buffer, n, i);
+      break;
+   default:
+      return pack_each(f, buffer, n, st, i);
+   }
+   return true;
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value, bool>::type
+   struc::pack_column(const field& f,
+                      char* buffer,
+                      size_t n,
+                      status& st,
+                      const T* t) const
+{
+   return pack_each(f, buffer, n, st, t);
+}
+
+template <typename T>
+inline bool struc::pack_each(const field& f,
+                             char* buffer,
+                             size_t n,
+                             status& st,
+                             const T* t) const
+{
+   for (size_t k = 0; k < n; ++k)
+   {
+      std::pair<size_t, char> cur(1, f.type);
+      size_t offset = k * record_stride;
+      if ((f.type == 's' || f.type == 'p') && !check_scalar(f.size, t[k], st))
+      {
+         return false;
+      }
+      if (!pack_scalar(c, cur, buffer, offset, st, t[k]))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+template <typename I, typename T>
+inline void struc::pack_native_column(char* buffer, size_t n, const I* i) const
+{
+   for (size_t k = 0; k < n; ++k, buffer += record_stride)
+   {
+      T t = static_cast<T>(i[k]);
+      std::memcpy(buffer, &t, sizeof(t));
+   }
+}
+
+template <typename I, typename T, typename U>
+inline void struc::pack_non_native_column(char* buffer,
+                                          size_t n,
+                                          const I* i) const
+{
+   static_assert(sizeof(T) == sizeof(U), "Size of T and U must be equal");
+   for (size_t k = 0; k < n; ++k, buffer += record_stride)
+   {
+      T t = static_cast<T>(i[k]);
+      U u;
+      std::memcpy(&u, &t, sizeof(u));
+      to_endian(c, u);
+      std::memcpy(buffer, &u, sizeof(u));
+   }
+}
+
+inline size_t struc::calcsize() const
+{
+   return size;
+}
+
+inline size_t struc::calcsize(const std::string& pattern)
+{
+   return cache::lookup(pattern)->calcsize();
+}
+
+inline size_t struc::stride() const
+{
+   return record_stride;
+}
+
+inline struc::records<struc::view> struc::iter_unpack(const char* buffer,
+                                                      size_t length) const
+{
+   return records<view>(
+      view(*this, buffer),
+      record_stride,
+      record_count("iter_unpack", length, size, record_stride));
+}
+
+template <typename It>
+inline size_t struc::pack_many(char* buffer, It first, It last) const
+{
+   size_t offset = 0;
+   for (; first != last; ++first, offset += record_stride)
+   {
+      pack(buffer + offset, *first);
+   }
+   return offset;
+}
+
+template <typename It, typename F>
+inline size_t struc::pack_many(char* buffer, It first, It last, F f) const
+{
+   size_t offset = 0;
+   for (; first != last; ++first, offset += record_stride)
+   {
+      pack(buffer + offset, f(*first));
+   }
+   return offset;
+}
+
+template <typename It>
+inline std::vector<char> struc::pack_many(It first, It last) const
+{
+   return pack_many(first, last, identity());
+}
+
+template <typename It, typename F>
+inline std::vector<char> struc::pack_many(It first, It last, F f) const
+{
+   return pack_many_vector(
+      first,
+      last,
+      f,
+      typename std::iterator_traits<It>::iterator_category());
+}
+
+template <typename It>
+inline std::vector<char> struc::pack_many(const std::string& pattern,
+                                          It first,
+                                          It last)
+{
+   return cache::lookup(pattern)->pack_many(first, last);
+}
+
+template <typename It, typename F>
+inline std::vector<char> struc::pack_many(const std::string& pattern,
+                                          It first,
+                                          It last,
+                                          F f)
+{
+   return cache::lookup(pattern)->pack_many(first, last, f);
+}
+
+template <typename T>
+inline const T& struc::identity::operator()(const T& t) const
+{
+   return t;
+}
+
+template <typename It, typename F>
+inline std::vector<char> struc::pack_many_vector(
+   It first,
+   It last,
+   F f,
+   std::forward_iterator_tag) const
+{
+   std::vector<char> v(
+      static_cast<size_t>(std::distance(first, last)) * record_stride, '\0');
+   pack_many(v.data(), first, last, f);
+   return v;
+}
+
+template <typename It, typename F>
+inline std::vector<char> struc::pack_many_vector(
+   It first,
+   It last,
+   F f,
+   std::input_iterator_tag) const
+{
+   std::vector<char> v;
+   for (; first != last; ++first)
+   {
+      size_t offset = v.size();
+      v.resize(offset + record_stride, '\0');
+      pack(v.data() + offset, f(*first));
+   }
+   return v;
+}
+
+template <typename T>
+inline struc::condition<T> struc::where(size_t index,
+                                        compare op,
+                                        const T& value)
+{
+   condition<T> c = {index, op, value};
+   return c;
+}
+
+template <typename... T>
+inline std::vector<size_t> struc::scan(const char* buffer,
+                                       size_t n,
+                                       const condition<T>&... conditions) const
+{
+   std::vector<size_t> indices;
+   unsigned char mask[scan_block];
+   // one block of decoded items per condition, reused for every block
+   std::tuple<std::unique_ptr<T[]>...> scratch{
+      std::unique_ptr<T[]>(new T[n < scan_block ? n : scan_block])...};
+   auto all = std::tie(conditions...);
+   status st = status();
+   for (size_t b = 0; b < n; b += scan_block)
+   {
+      size_t m = n - b < scan_block ? n - b : scan_block;
+      std::fill(mask, mask + m, 1);
+      if (!scan_helper(buffer + b * record_stride, m, mask, st, all, scratch))
+      {
+         raise("scan", st);
+      }
+      for (size_t k = 0; k < m; ++k)
+      {
+         if (mask[k])
+         {
+            indices.push_back(b + k);
+         }
+      }
+   }
+   return indices;
+}
+
+template <typename P>
+inline std::vector<size_t> struc::scan_if(const char* buffer,
+                                          size_t n,
+                                          P predicate) const
+{
+   std::vector<size_t> indices;
+   for (size_t k = 0; k < n; ++k)
+   {
+      if (predicate(view(*this, buffer + k * record_stride)))
+      {
+         indices.push_back(k);
+      }
+   }
+   return indices;
+}
+
+template <size_t I, typename... T>
+inline typename std::enable_if<I == sizeof...(T), bool>::type
+   struc::scan_helper(const char*,
+                      size_t,
+                      unsigned char*,
+                      status&,
+                      const std::tuple<const condition<T>&...>&,
+                      std::tuple<std::unique_ptr<T[]>...>&) const
+{
+   return true;
+}
+
+template <size_t I, typename... T>
+inline typename std::enable_if<(I < sizeof...(T)), bool>::type
+   struc::scan_helper(const char* buffer,
+                      size_t n,
+                      unsigned char* mask,
+                      status& st,
+                      const std::tuple<const condition<T>&...>& conditions,
+                      std::tuple<std::unique_ptr<T[]>...>& scratch) const
+{
+   const auto& c = std::get<I>(conditions);
+   auto t = std::get<I>(scratch).get();
+   st.index = c.index;
+   size_t offset;
+   auto f = item_field(c.index, offset);
+   if (!f)
+   {
+      return fail(st, errc::index_out_of_range);
+   }
+   if (!unpack_column(*f, buffer + offset, n, st, t))
+   {
+      return false;
+   }
+   compare_block(c.op, t, n, c.value, mask);
+   return scan_helper<I + 1>(buffer, n, mask, st, conditions, scratch);
+}
+
+template <typename T>
+inline void struc::compare_block(compare op,
+                                 const T* t,
+                                 size_t n,
+                                 const T& value,
+                                 unsigned char* mask)
+{
+   // one loop per operator, so that the compiler can vectorize it
+   switch (op)
+   {
+   case compare::eq:
+      for (size_t k = 0; k < n; ++k)
+      {
+         mask[k] &= t[k] == value;
+      }
+      break;
+   case compare::ne:
+      for (size_t k = 0; k < n; ++k)
+      {
+         mask[k] &= t[k] != value;
+      }
+      break;
+   case compare::lt:
+      for (size_t k = 0; k < n; ++k)
+      {
+         mask[k] &= t[k] < value;
+      }
+      break;
+   case compare::le:
+      for (size_t k = 0; k < n; ++k)
+      {
+         mask[k] &= t[k] <= value;
+      }
+      break;
+   case compare::gt:
+      for (size_t k = 0; k < n; ++k)
+      {
+         mask[k] &= t[k] > value;
+      }
+      break;
+   case compare::ge:
+      for (size_t k = 0; k < n; ++k)
+      {
+         mask[k] &= t[k] >= value;
+      }
+      break;
+   }
+}
+
+inline void struc::sort_records(char* buffer, size_t n, size_t index) const
+{
+   status st = status();
+   if (n <= std::numeric_limits<uint32_t>::max())
+   {
+      std::vector<uint32_t> order;
+      if (!sort_helper(buffer, n, index, st, order))
+      {
+         raise("sort_records", st);
+      }
+      permute_records(buffer, order);
+      return;
+   }
+   std::vector<size_t> order;
+   if (!sort_helper(buffer, n, index, st, order))
+   {
+      raise("sort_records", st);
+   }
+   permute_records(buffer, order);
+}
+
+inline std::vector<size_t> struc::sort_index(const char* buffer,
+                                             size_t n,
+                                             size_t index) const
+{
+   std::vector<size_t> order;
+   status st = status();
+   if (!sort_helper(buffer, n, index, st, order))
+   {
+      raise("sort_index", st);
+   }
+   return order;
+}
+
+template <typename I>
+inline bool struc::sort_helper(const char* buffer,
+                               size_t n,
+                               size_t index,
+                               status& st,
+                               std::vector<I>& order) const
+{
+   st.index = index;
+   size_t offset;
+   auto f = item_field(index, offset);
+   if (!f)
+   {
+      return fail(st, errc::index_out_of_range);
+   }
+   bool floating = false;
+   bool sign = false;
+   switch (f->type)
+   {
+   case 'b':
+   case 'h':
+   case 'i':
+   case 'l':
+   case 'q':
+      sign = true;
+      break;
+   case 'f':
+      floating = c != native || is_ieee<float>();
+      break;
+   case 'd':
+      floating = c != native || is_ieee<double>();
+      break;
+   case 'c':
+   case 'B':
+   case '?':
+   case 'H':
+   case 'I':
+   case 'L':
+   case 'Q':
+   case 'P':
+      break;
+   default:
+      return fail(st, errc::illegal_type);
+   }
+   if ((f->type == 'f' || f->type == 'd') && !floating)
+   {
+      // native floats that are not IEEE have no known bit layout
+      return fail(st, errc::illegal_type);
+   }
+   buffer += offset;
+   switch (f->size)
+   {
+   case 1:
+      radix_sort<uint8_t, I>(buffer, n, sign ? 0x80 : 0, floating, order);
+      break;
+   case 2:
+      radix_sort<uint16_t, I>(buffer, n, sign ? 0x8000 : 0, floating, order);
+      break;
+   case 4:
+      radix_sort<uint32_t, I>(
+         buffer, n, sign ? UINT32_C(0x80000000) : 0, floating, order);
+      break;
+   case 8:
+      radix_sort<uint64_t, I>(buffer,
+                           n,
+                           sign ? UINT64_C(0x8000000000000000) : 0,
+                           floating,
+                           order);
+      break;
+   default:
+      return fail(st, errc::illegal_type);
+   }
+   return true;
+}
+
+template <typename U, typename I>
+inline void struc::radix_sort(const char* buffer,
+                              size_t n,
+                              U flip,
+                              bool floating,
+                              std::vector<I>& order) const
+{
+   const size_t digits = sizeof(U);
+   const U top = static_cast<U>(U(1) << (8 * digits - 1));
+   const bool swap = needs_swap(c);
+   std::vector<U> keys(n);
+   std::vector<size_t> counts(digits * 256, 0);
+   for (size_t k = 0; k < n; ++k)
+   {
+      U u;
+      std::memcpy(&u, buffer + k * record_stride, sizeof(u));
+      if (swap)
+      {
+         u = boost::endian::endian_reverse(u);
+      }
+      // negative floats order backwards, so all of their bits are flipped
+      if (floating)
+      {
+         u = (u & top) ? static_cast<U>(~u) : static_cast<U>(u | top);
+      }
+      else
+      {
+         u = static_cast<U>(u ^ flip);
+      }
+      keys[k] = u;
+      for (size_t d = 0; d < digits; ++d)
+      {
+         ++counts[d * 256 + ((u >> (8 * d)) & 0xff)];
+      }
+   }
+   // only indices move between passes, the keys are looked up by index
+   order.resize(n);
+   for (size_t k = 0; k < n; ++k)
+   {
+      order[k] = static_cast<I>(k);
+   }
+   std::vector<I> next(n);
+   for (size_t d = 0; d < digits && n > 0; ++d)
+   {
+      size_t* count = &counts[d * 256];
+      if (count[(keys[0] >> (8 * d)) & 0xff] == n)
+      {
+         // every key has the same digit, the pass would not move anything
+         continue;
+      }
+      size_t total = 0;
+      for (size_t k = 0; k < 256; ++k)
+      {
+         size_t m = count[k];
+         count[k] = total;
+         total += m;
+      }
+      for (size_t k = 0; k < n; ++k)
+      {
+         I i = order[k];
+         next[count[(keys[i] >> (8 * d)) & 0xff]++] = i;
+      }
+      order.swap(next);
+   }
+}
+
+template <typename I>
+inline void struc::permute_records(char* buffer, std::vector<I>& order) const
+{
+   // records move along the cycles of the permutation through one spare
+   // record, order[k] == k marks the records already in place
+   std::vector<char> spare(size);
+   for (size_t k = 0; k < order.size(); ++k)
+   {
+      if (order[k] == k)
+      {
+         continue;
+      }
+      std::memcpy(spare.data(), buffer + k * record_stride, size);
+      size_t j = k;
+      while (order[j] != k)
+      {
+         size_t from = order[j];
+         std::memcpy(
+            buffer + j * record_stride, buffer + from * record_stride, size);
+         order[j] = static_cast<I>(j);
+         j = from;
+      }
+      std::memcpy(buffer + j * record_stride, spare.data(), size);
+      order[j] = static_cast<I>(j);
+   }
+}
+
+template <typename T>
+inline double struc::summary<T>::mean() const
+{
+   return count == 0 ? std::numeric_limits<double>::quiet_NaN() :
+                       static_cast<double>(sum) / static_cast<double>(count);
+}
+
+template <typename T>
+inline struc::summary<T> struc::summarize(const char* buffer,
+                                          size_t n,
+                                          size_t index) const
+{
+   auto s = empty_summary<T>();
+   status st = status();
+   if (!summarize_helper(buffer, n, index, st, s))
+   {
+      raise("summarize", st);
+   }
+   return s;
+}
+
+template <typename T, typename P>
+inline size_t struc::count_if(const char* buffer,
+                              size_t n,
+                              size_t index,
+                              P predicate) const
+{
+   size_t count = 0;
+   status st = status();
+   if (!for_each_block<T>(buffer, n, index, st, [&](const T* t, size_t m) {
+          for (size_t k = 0; k < m; ++k)
+          {
+             count += predicate(t[k]) ? 1 : 0;
+          }
+       }))
+   {
+      raise("count_if", st);
+   }
+   return count;
+}
+
+template <typename T>
+inline std::vector<size_t> struc::histogram(const char* buffer,
+                                            size_t n,
+                                            size_t index,
+                                            double low,
+                                            double high,
+                                            size_t buckets) const
+{
+   check_histogram(low, high, buckets);
+   std::vector<size_t> h(buckets, 0);
+   status st = status();
+   if (!histogram_helper<T>(buffer, n, index, low, high, st, h))
+   {
+      raise("histogram", st);
+   }
+   return h;
+}
+
+template <typename T, typename E>
+inline struc::summary<T> struc::summarize_parallel(E executor,
+                                                   const char* buffer,
+                                                   size_t n,
+                                                   size_t index) const
+{
+   auto s = empty_summary<T>();
+   std::mutex mutex;
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& r) {
+      auto part = empty_summary<T>();
+      if (summarize_helper(
+             buffer + b * record_stride, e - b, index, r, part))
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         merge(s, part);
+      }
+   });
+   if (st.code != errc())
+   {
+      raise("summarize", st);
+   }
+   return s;
+}
+
+template <typename T, typename E, typename P>
+inline size_t struc::count_if_parallel(E executor,
+                                       const char* buffer,
+                                       size_t n,
+                                       size_t index,
+                                       P predicate) const
+{
+   std::atomic<size_t> count(0);
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& r) {
+      size_t part = 0;
+      for_each_block<T>(buffer + b * record_stride,
+                        e - b,
+                        index,
+                        r,
+                        [&](const T* t, size_t m) {
+                           for (size_t k = 0; k < m; ++k)
+                           {
+                              part += predicate(t[k]) ? 1 : 0;
+                           }
+                        });
+      count += part;
+   });
+   if (st.code != errc())
+   {
+      raise("count_if", st);
+   }
+   return count;
+}
+
+template <typename T, typename E>
+inline std::vector<size_t> struc::histogram_parallel(E executor,
+                                                     const char* buffer,
+                                                     size_t n,
+                                                     size_t index,
+                                                     double low,
+                                                     double high,
+                                                     size_t buckets) const
+{
+   check_histogram(low, high, buckets);
+   std::vector<size_t> h(buckets, 0);
+   std::mutex mutex;
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& r) {
+      std::vector<size_t> part(buckets, 0);
+      if (histogram_helper<T>(
+             buffer + b * record_stride, e - b, index, low, high, r, part))
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         for (size_t k = 0; k < buckets; ++k)
+         {
+            h[k] += part[k];
+         }
+      }
+   });
+   if (st.code != errc())
+   {
+      raise("histogram", st);
+   }
+   return h;
+}
+
+template <typename T, typename F>
+inline bool struc::for_each_block(const char* buffer,
+                                  size_t n,
+                                  size_t index,
+                                  status& st,
+                                  F f) const
+{
+   st.index = index;
+   size_t offset;
+   auto field = item_field(index, offset);
+   if (!field)
+   {
+      return fail(st, errc::index_out_of_range);
+   }
+   std::unique_ptr<T[]> t(new T[n < scan_block ? n : scan_block]);
+   for (size_t b = 0; b < n; b += scan_block)
+   {
+      size_t m = n - b < scan_block ? n - b : scan_block;
+      if (!unpack_column(
+             *field, buffer + b * record_stride + offset, m, st, t.get()))
+      {
+         return false;
+      }
+      f(static_cast<const T*>(t.get()), m);
+   }
+   return true;
+}
+
+template <typename T>
+inline void struc::merge(summary<T>& s, const summary<T>& t)
+{
+   s.count += t.count;
+   s.sum += t.sum;
+   s.min = std::min(s.min, t.min);
+   s.max = std::max(s.max, t.max);
+}
+
+template <typename T>
+inline struc::summary<T> struc::empty_summary()
+{
+   summary<T> s = {0,
+                   typename summary<T>::sum_type(),
+                   std::numeric_limits<T>::max(),
+                   std::numeric_limits<T>::lowest()};
+   return s;
+}
+
+template <typename T>
+inline bool struc::summarize_helper(const char* buffer,
+                                    size_t n,
+                                    size_t index,
+                                    status& st,
+                                    summary<T>& s) const
+{
+   return for_each_block<T>(buffer, n, index, st, [&](const T* t, size_t m) {
+      // separate loops vectorize better than one loop with three results
+      typename summary<T>::sum_type sum = 0;
+      for (size_t k = 0; k < m; ++k)
+      {
+         sum += t[k];
+      }
+      T min = s.min;
+      for (size_t k = 0; k < m; ++k)
+      {
+         min = t[k] < min ? t[k] : min;
+      }
+      T max = s.max;
+      for (size_t k = 0; k < m; ++k)
+      {
+         max = t[k] > max ? t[k] : max;
+      }
+      s.count += m;
+      s.sum += sum;
+      s.min = min;
+      s.max = max;
+   });
+}
+
+inline void struc::check_histogram(double low, double high, size_t buckets)
+{
+   if (buckets == 0)
+   {
+      STRUC_THROW(std::invalid_argument("histogram: no buckets"));
+   }
+   // also rejects NaN bounds
+   if (!(low < high))
+   {
+      STRUC_THROW(std::invalid_argument("histogram: high is not above low"));
+   }
+}
+
+template <typename T>
+inline bool struc::histogram_helper(const char* buffer,
+                                    size_t n,
+                                    size_t index,
+                                    double low,
+                                    double high,
+                                    status& st,
+                                    std::vector<size_t>& h) const
+{
+   const double scale = static_cast<double>(h.size()) / (high - low);
+   return for_each_block<T>(buffer, n, index, st, [&](const T* t, size_t m) {
+      for (size_t k = 0; k < m; ++k)
+      {
+         double v = static_cast<double>(t[k]);
+         if (v >= low && v < high)
+         {
+            auto bucket = static_cast<size_t>((v - low) * scale);
+            ++h[std::min(bucket, h.size() - 1)];
+         }
+      }
+   });
+}
+
+template <typename It>
+inline void struc::unpack_many(const char* buffer, size_t n, It out) const
+{
+   for (size_t k = 0; k < n; ++k, ++out, buffer += record_stride)
+   {
+      unpack(buffer, *out);
+   }
+}
+
+template <typename E, typename It>
+inline size_t struc::pack_many_parallel(E executor,
+                                        char* buffer,
+                                        It first,
+                                        It last) const
+{
+   auto n = static_cast<size_t>(last - first);
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& s) {
+      for (size_t k = b; k < e && s.code == errc(); ++k)
+      {
+         s = try_pack(buffer + k * record_stride, first[k]);
+      }
+   });
+   if (st.code != errc())
+   {
+      raise("pack", st);
+   }
+   return n * record_stride;
+}
+
+template <typename E, typename It, typename F>
+inline size_t struc::pack_many_parallel(E executor,
+                                        char* buffer,
+                                        It first,
+                                        It last,
+                                        F f) const
+{
+   auto n = static_cast<size_t>(last - first);
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& s) {
+      for (size_t k = b; k < e && s.code == errc(); ++k)
+      {
+         s = try_pack(buffer + k * record_stride, f(first[k]));
+      }
+   });
+   if (st.code != errc())
+   {
+      raise("pack", st);
+   }
+   return n * record_stride;
+}
+
+template <typename E, typename It>
+inline void struc::unpack_many_parallel(E executor,
+                                        const char* buffer,
+                                        size_t n,
+                                        It out) const
+{
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& s) {
+      for (size_t k = b; k < e && s.code == errc(); ++k)
+      {
+         s = try_unpack(buffer + k * record_stride, out[k]);
+      }
+   });
+   if (st.code != errc())
+   {
+      raise("unpack", st);
+   }
+}
+
+template <typename E, typename... T>
+inline void struc::unpack_columns_parallel(E executor,
+                                           const char* buffer,
+                                           size_t n,
+                                           T&&... columns) const
+{
+   status st = status();
+   if (!check_columns(sizeof...(T), st))
+   {
+      raise("unpack_columns", st);
+   }
+   // vectors are resized here, before the columns are shared out
+   unpack_column_chunks(executor, buffer, n, column_data(columns, n)...);
+}
+
+template <typename E, typename... T>
+inline void struc::pack_columns_parallel(E executor,
+                                         char* buffer,
+                                         size_t n,
+                                         const T&... columns) const
+{
+   status st = status();
+   if (!check_columns(sizeof...(T), st)
+       || !check_column_lengths(0, n, st, columns...))
+   {
+      raise("pack_columns", st);
+   }
+   pack_column_chunks(executor, buffer, n, column_data(columns, n)...);
+}
+
+template <typename E, typename F>
+inline struc::status struc::parallel_for(E& executor, size_t n, F f) const
+{
+   size_t chunks = std::min(executor.concurrency(), n);
+   std::vector<status> results(chunks, status());
+   if (chunks > 0)
+   {
+      executor(chunks, [&](size_t k) {
+         f(k * n / chunks, (k + 1) * n / chunks, results[k]);
+      });
+   }
+   for (const auto& st : results)
+   {
+      if (st.code != errc())
+      {
+         return st;
+      }
+   }
+   return status();
+}
+
+template <typename E, typename... T>
+inline void struc::unpack_column_chunks(E& executor,
+                                        const char* buffer,
+                                        size_t n,
+                                        T*... columns) const
+{
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& s) {
+      unpack_columns_helper(
+         0, buffer + b * record_stride, e - b, s, (columns + b)...);
+   });
+   if (st.code != errc())
+   {
+      raise("unpack_columns", st);
+   }
+}
+
+template <typename E, typename... T>
+inline void struc::pack_column_chunks(E& executor,
+                                      char* buffer,
+                                      size_t n,
+                                      const T*... columns) const
+{
+   auto st = parallel_for(executor, n, [&](size_t b, size_t e, status& s) {
+      pack_columns_helper(
+         0, buffer + b * record_stride, e - b, s, (columns + b)...);
+   });
+   if (st.code != errc())
    {
-      throw std::logic_error(std::string("String has wrong length ")
-                             + std::to_string(s.size())
-                             + ", expected "
-                             + std::to_string(num));
+      raise("pack_columns", st);
    }
 }
 
-template <typename S>
-inline typename std::enable_if<std::is_constructible<std::string, S>::value
-                                  && !std::is_null_pointer<S>::value
-                                  && !std::is_same<std::string, S>::value,
-                               void>::type
-   struc::check_scalar(size_t num, const S& s)
+inline bool struc::check_column_lengths(size_t, size_t, status&) const
 {
-   if (std::strlen(s) != num)
+   return true;
+}
+
+template <typename T, typename... Ts>
+inline bool struc::check_column_lengths(size_t index,
+                                        size_t n,
+                                        status& st,
+                                        const T& column,
+                                        const Ts&... columns) const
+{
+   if (column_length(column) < n)
    {
-      throw std::logic_error(std::string("String has wrong length ")
-                             + std::to_string(std::strlen(s))
-                             + ", expected "
-                             + std::to_string(num));
+      st.index = index;
+      return fail(st, errc::array_too_small, n, column_length(column));
    }
+   return check_column_lengths(index + 1, n, st, columns...);
 }
 
-template <typename S>
-inline typename std::enable_if<!std::is_constructible<std::string, S>::value
-                                  || std::is_null_pointer<S>::value,
-                               void>::type
+inline size_t struc::record_count(const char* what,
+                                  size_t length,
+                                  size_t size,
+                                  size_t stride)
+{
+   // the last record doesn't need its trailing padding
+   if (size == 0 || (length % stride != 0 && length % stride != size))
+   {
+      status st = status();
+      fail(st, errc::partial_record, stride, length);
+      raise(what, st, 'x');
+   }
+   return length / stride + (length % stride != 0 ? 1 : 0);
+}
 
-   struc::check_scalar(size_t, const S&)
+inline void struc::check_record_size(const char* what, size_t size)
 {
+   // records of no bytes would never end
+   if (size == 0)
+   {
+      status st = status();
+      fail(st, errc::partial_record);
+      raise(what, st, 'x');
+   }
 }
 
-template <typename S>
-inline typename std::enable_if<std::is_same<std::string, S>::value, void>::type
-   struc::prep_scalar(size_t num, S& s)
+inline constexpr size_t struc::max_of(size_t a)
 {
-   s = S(num, '\0');
+   return a;
 }
 
-template <typename S>
-inline typename std::enable_if<std::is_constructible<std::string, S>::value
-                                  && !std::is_null_pointer<S>::value
-                                  && !std::is_same<std::string, S>::value,
-                               void>::type
-   struc::prep_scalar(size_t num, S& s)
+template <typename... A>
+inline constexpr size_t struc::max_of(size_t a, size_t b, A... c)
 {
-   for (size_t i = 0; i < num; ++i)
+   return max_of(a > b ? a : b, c...);
+}
+
+inline std::shared_ptr<const struc> struc::cache::get(
+   const std::string& pattern)
+{
+   return lookup(pattern);
+}
+
+inline size_t struc::cache::capacity()
+{
+   auto& t = shared();
+   std::lock_guard<std::mutex> lock(t.mutex);
+   return t.capacity;
+}
+
+inline void struc::cache::capacity(size_t capacity)
+{
+   auto& t = shared();
+   std::lock_guard<std::mutex> lock(t.mutex);
+   t.capacity = capacity;
+   evict(t);
+   t.generation++;
+}
+
+inline size_t struc::cache::size()
+{
+   auto& t = shared();
+   std::lock_guard<std::mutex> lock(t.mutex);
+   return t.entries.size();
+}
+
+inline void struc::cache::clear()
+{
+   auto& t = shared();
+   std::lock_guard<std::mutex> lock(t.mutex);
+   t.index.clear();
+   t.entries.clear();
+   t.generation++;
+}
+
+inline struc::cache::table& struc::cache::shared()
+{
+   static table t{{}, {}, {}, 256, {}};
+   return t;
+}
+
+inline std::shared_ptr<const struc> struc::cache::lookup(
+   const std::string& pattern)
+{
+   static thread_local local_entry local[local_slots];
+   auto& l = local[std::hash<std::string>()(pattern) % local_slots];
+   size_t generation = shared().generation.load();
+   if (l.e.second && l.generation == generation && l.e.first == pattern)
    {
-      s[i] = ' ';
+      return l.e.second;
    }
-   s[num] = '\0';
+   bool cached = false;
+   auto s = lookup_shared(pattern, cached);
+   if (cached)
+   {
+      l.e.first = pattern;
+      l.e.second = s;
+      l.generation = generation;
+   }
+   else
+   {
+      l.e.second.reset();
+   }
+   return s;
 }
 
-template <typename S>
-inline typename std::enable_if<!std::is_constructible<std::string, S>::value
-                                  || std::is_null_pointer<S>::value,
-                               void>::type
-   struc::prep_scalar(size_t, S&)
+inline std::shared_ptr<const struc> struc::cache::lookup_shared(
+   const std::string& pattern,
+   bool& cached)
+{
+   auto& t = shared();
+   {
+      std::lock_guard<std::mutex> lock(t.mutex);
+      auto it = t.index.find(pattern);
+      if (it != t.index.end())
+      {
+         t.entries.splice(t.entries.begin(), t.entries, it->second);
+         cached = true;
+         return it->second->second;
+      }
+   }
+   auto compiled = std::make_shared<const struc>(pattern);
+   std::lock_guard<std::mutex> lock(t.mutex);
+   if (t.capacity > 0)
+   {
+      auto it = t.index.find(pattern);
+      if (it != t.index.end())
+      {
+         // compiled by another thread meanwhile
+         cached = true;
+         return it->second->second;
+      }
+      t.entries.emplace_front(pattern, compiled);
+      t.index[pattern] = t.entries.begin();
+      evict(t);
+      cached = true;
+   }
+   return compiled;
+}
+
+inline void struc::cache::evict(table& t)
+{
+   while (t.entries.size() > t.capacity)
+   {
+      t.index.erase(t.entries.back().first);
+      t.entries.pop_back();
+   }
+}
+
+inline struc::view::view(const struc& s_, const char* buffer_)
+: s(&s_)
+, buffer(buffer_)
 {
 }
 
 template <typename T>
-inline size_t struc::padding(const size_t& sz)
+inline T struc::view::get(size_t index) const
 {
-   size_t pad = sz % alignof(T);
-   return pad == 0 ? pad : alignof(T) - pad;
+   T t = T();
+   s->unpack_field(buffer, index, t);
+   return t;
 }
 
-inline size_t struc::native_padding(const size_t& sz, char type)
+template <typename T>
+inline void struc::view::get(size_t index, T& t) const
 {
-   switch (type)
+   s->unpack_field(buffer, index, t);
+}
+
+inline const char* struc::view::data(size_t index) const
+{
+   size_t offset;
+   if (!s->item_field(index, offset))
    {
-   case 'h':
-      return padding<short>(sz);
-   case 'H':
-      return padding<unsigned short>(sz);
-   case 'i':
-      return padding<int>(sz);
-   case 'I':
-      return padding<unsigned int>(sz);
-   case 'l':
-      return padding<long>(sz);
-   case 'L':
-      return padding<unsigned long>(sz);
-   case 'q':
-      return padding<long long>(sz);
-   case 'Q':
-      return padding<unsigned long long>(sz);
-   case 'f':
-      return padding<float>(sz);
-   case 'd':
-      return padding<double>(sz);
-   case 'P':
-      return padding<void*>(sz);
-   case 'x':
-   case 'c':
-   case 'b':
-   case 'B':
-   case '?':
-   case 's':
-   case 'p':
-      return 0;
-   default:
-      throw std::logic_error(std::string("Encountered illegal type: ") + type);
+      status st = status();
+      st.index = index;
+      fail(st, errc::index_out_of_range);
+      raise("data", st, 'x');
    }
+   return buffer + offset;
 }
 
-inline size_t struc::native_alignment(char type)
+inline const char* struc::view::data() const
 {
-   switch (type)
+   return buffer;
+}
+
+template <typename... T>
+inline void struc::view::unpack(T&... t) const
+{
+   s->unpack(buffer, t...);
+}
+
+template <typename... T>
+inline void struc::view::unpack(std::tuple<T...>& t) const
+{
+   s->unpack(buffer, t);
+}
+
+inline struc::thread_executor::thread_executor(size_t threads_)
+: threads(threads_ != 0 ? threads_ : std::thread::hardware_concurrency())
+{
+   if (threads == 0)
    {
-   case 'h':
-      return alignof(short);
-   case 'H':
-      return alignof(unsigned short);
-   case 'i':
-      return alignof(int);
-   case 'I':
-      return alignof(unsigned int);
-   case 'l':
-      return alignof(long);
-   case 'L':
-      return alignof(unsigned long);
-   case 'q':
-      return alignof(long long);
-   case 'Q':
-      return alignof(unsigned long long);
-   case 'f':
-      return alignof(float);
-   case 'd':
-      return alignof(double);
-   case 'P':
-      return alignof(void*);
-   case 'x':
-   case 'c':
-   case 'b':
-   case 'B':
-   case '?':
-   case 's':
-   case 'p':
-      return 1;
+      threads = 1;
+   }
+}
+
+inline size_t struc::thread_executor::concurrency() const
+{
+   return threads;
+}
+
+inline void struc::thread_executor::operator()(
+   size_t chunks,
+   const std::function<void(size_t)>& task) const
+{
+   std::atomic<size_t> next(0);
+#ifdef BOOST_NO_EXCEPTIONS
+   auto work = [&]() {
+      for (size_t k = next++; k < chunks; k = next++)
+      {
+         task(k);
+      }
+   };
+#else
+   std::mutex mutex;
+   std::exception_ptr error;
+   auto work = [&]() {
+      for (size_t k = next++; k < chunks; k = next++)
+      {
+         try
+         {
+            task(k);
+         }
+         catch (...)
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error)
+            {
+               error = std::current_exception();
+            }
+            next = chunks;
+         }
+      }
+   };
+#endif
+   std::vector<std::thread> pool;
+   for (size_t i = 1; i < std::min(threads, chunks); ++i)
+   {
+      pool.emplace_back(work);
+   }
+   work();
+   for (auto& t : pool)
+   {
+      t.join();
+   }
+#ifndef BOOST_NO_EXCEPTIONS
+   if (error)
+   {
+      std::rethrow_exception(error);
+   }
+#endif
+}
+
+template <typename T>
+inline struc::span<T>::span(T* data_, size_t size_)
+: ptr(data_)
+, length(size_)
+{
+}
+
+template <typename T>
+inline T* struc::span<T>::data() const
+{
+   return ptr;
+}
+
+template <typename T>
+inline size_t struc::span<T>::size() const
+{
+   return length;
+}
+
+template <typename T>
+inline struc::span<T> struc::make_span(T* data, size_t size)
+{
+   return span<T>(data, size);
+}
+
+#ifdef STRUC_POSIX
+inline struc::mapped_file::mapped_file(const struc& s_,
+                                       const std::string& path,
+                                       size_t header_size_)
+: s(&s_)
+, mapping(nullptr, unmapper{0})
+, skip(header_size_)
+, count(0)
+{
+   int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+   struct stat st;
+   if (fd < 0 || ::fstat(fd, &st) != 0)
+   {
+      int e = errno;
+      if (fd >= 0)
+      {
+         ::close(fd);
+      }
+      STRUC_THROW(std::system_error(
+         e, std::generic_category(), "mapped_file: " + path));
+   }
+   size_t length = static_cast<size_t>(st.st_size);
+   if (length > 0)
+   {
+      void* p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+      int e = errno;
+      ::close(fd);
+      if (p == MAP_FAILED)
+      {
+         STRUC_THROW(std::system_error(
+            e, std::generic_category(), "mapped_file: " + path));
+      }
+      // unmapped by the member if the checks below throw
+      mapping = std::unique_ptr<char, unmapper>(static_cast<char*>(p),
+                                                unmapper{length});
+   }
+   else
+   {
+      ::close(fd);
+   }
+   if (length < skip)
+   {
+      STRUC_THROW(std::out_of_range("mapped_file: " + path
+                                    + " is shorter than its header"));
+   }
+   count =
+      record_count("mapped_file", length - skip, s->size, s->record_stride);
+}
+
+inline size_t struc::mapped_file::size() const
+{
+   return count;
+}
+
+inline bool struc::mapped_file::empty() const
+{
+   return count == 0;
+}
+
+inline struc::view struc::mapped_file::operator[](size_t i) const
+{
+   return view(*s, data() + i * s->record_stride);
+}
+
+inline struc::view struc::mapped_file::at(size_t i) const
+{
+   if (i >= count)
+   {
+      STRUC_THROW(std::out_of_range("mapped_file: record out of range"));
+   }
+   return (*this)[i];
+}
+
+inline struc::records<struc::view>::iterator struc::mapped_file::begin() const
+{
+   return records<view>::iterator(view(*s, data()), s->record_stride);
+}
+
+inline struc::records<struc::view>::iterator struc::mapped_file::end() const
+{
+   return begin() + static_cast<std::ptrdiff_t>(count);
+}
+
+inline void struc::mapped_file::advise(advice a) const
+{
+   advise(a, 0, count);
+}
+
+inline void struc::mapped_file::advise(advice a,
+                                       size_t first,
+                                       size_t count_) const
+{
+   if (!mapping || first >= count)
+   {
+      return;
+   }
+   count_ = std::min(count_, count - first);
+   // madvise wants a page aligned address
+   size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+   size_t begin = skip + first * s->record_stride;
+   size_t end = std::min(begin + count_ * s->record_stride,
+                         mapping.get_deleter().length);
+   begin -= begin % page;
+   // only a hint, so failures are ignored
+   ::madvise(mapping.get() + begin, end - begin, native_advice(a));
+}
+
+inline const char* struc::mapped_file::header() const
+{
+   return mapping.get();
+}
+
+inline size_t struc::mapped_file::header_size() const
+{
+   return skip;
+}
+
+inline const char* struc::mapped_file::data() const
+{
+   return mapping.get() + skip;
+}
+
+inline void struc::mapped_file::unmapper::operator()(char* p) const
+{
+   ::munmap(p, length);
+}
+
+inline int struc::mapped_file::native_advice(advice a)
+{
+   switch (a)
+   {
+   case advice::sequential:
+      return MADV_SEQUENTIAL;
+   case advice::random:
+      return MADV_RANDOM;
+   case advice::willneed:
+      return MADV_WILLNEED;
+   case advice::dontneed:
+      return MADV_DONTNEED;
    default:
-      throw std::logic_error(std::string("Encountered illegal type: ") + type);
+      return MADV_NORMAL;
    }
 }
+#endif
 
-template <typename F>
-inline typename std::enable_if<std::is_same<F, float>::value, bool>::type
-   struc::is_ieee()
+#ifdef STRUC_POSIX
+inline struc::reader::reader(const struc& s_, int fd_, size_t chunk_size)
+: s(&s_)
+, fd(fd_)
+, is(nullptr)
+, chunk(std::max(chunk_size, s_.record_stride))
+, pos(0)
+, filled(0)
+, eof(false)
+, current(s_, nullptr)
+{
+   check_record_size("reader", s_.size);
+}
+#endif
+
+inline struc::reader::reader(const struc& s_,
+                             std::istream& is_,
+                             size_t chunk_size)
+: s(&s_)
+, fd(-1)
+, is(&is_)
+, chunk(std::max(chunk_size, s_.record_stride))
+, pos(0)
+, filled(0)
+, eof(false)
+, current(s_, nullptr)
+{
+   check_record_size("reader", s_.size);
+}
+
+inline bool struc::reader::next(view& v)
 {
-   static std::atomic_flag flag = ATOMIC_FLAG_INIT;
-   static bool is_ieee_float = false;
-   if (!flag.test_and_set())
+   for (;;)
    {
-      if (sizeof(double) == 8)
+      size_t left = filled - pos;
+      if (left >= s->record_stride || (eof && left >= s->size && left > 0))
       {
-         float x = 16711938.0f;
-#ifdef BOOST_BIG_ENDIAN
-         is_ieee_float = memcmp(&x, "\x4b\x7f\x01\x02", 4) == 0;
-#else
-         is_ieee_float = memcmp(&x, "\x02\x01\x7f\x4b", 4) == 0;
-#endif
+         v = view(*s, chunk.data() + pos);
+         pos += std::min(left, s->record_stride);
+         return true;
       }
-      else
+      if (!fill())
       {
-         is_ieee_float = false;
+         if (left != 0)
+         {
+            status st = status();
+            fail(st, errc::partial_record, s->size, left);
+            raise("reader", st, 'x');
+         }
+         return false;
       }
    }
-   return is_ieee_float;
 }
 
 template <typename F>
-inline typename std::enable_if<std::is_same<F, double>::value, bool>::type
-   struc::is_ieee()
+inline size_t struc::reader::for_each(F f)
 {
-   static std::atomic_flag flag = ATOMIC_FLAG_INIT;
-   static bool is_ieee_double = false;
-   if (!flag.test_and_set())
+   size_t n = 0;
+   view v(*s, nullptr);
+   while (next(v))
    {
-      if (sizeof(double) == 8)
+      f(static_cast<const view&>(v));
+      ++n;
+   }
+   return n;
+}
+
+inline struc::reader::iterator struc::reader::begin()
+{
+   return next(current) ? iterator(this) : end();
+}
+
+inline struc::reader::iterator struc::reader::end()
+{
+   return iterator(nullptr);
+}
+
+inline bool struc::reader::fill()
+{
+   if (eof)
+   {
+      return false;
+   }
+   // carry the partial record over to the front of the chunk
+   size_t left = filled - pos;
+   std::memmove(chunk.data(), chunk.data() + pos, left);
+   pos = 0;
+   filled = left;
+   size_t n = 0;
+#ifdef STRUC_POSIX
+   if (is == nullptr)
+   {
+      ssize_t r;
+      do
       {
-         double x = 9006104071832581.0;
-#ifdef BOOST_BIG_ENDIAN
-         is_ieee_double =
-            memcmp(&x, "\x43\x3f\xff\x01\x02\x03\x04\x05", 8) == 0;
-#else
-         is_ieee_double =
-            memcmp(&x, "\x05\x04\x03\x02\x01\xff\x3f\x43", 8) == 0;
-#endif
+         r = ::read(fd, chunk.data() + filled, chunk.size() - filled);
+      } while (r < 0 && errno == EINTR);
+      if (r < 0)
+      {
+         STRUC_THROW(
+            std::system_error(errno, std::generic_category(), "reader"));
       }
-      else
+      n = static_cast<size_t>(r);
+   }
+   else
+#endif
+   {
+      is->read(chunk.data() + filled,
+               static_cast<std::streamsize>(chunk.size() - filled));
+      if (is->bad())
       {
-         is_ieee_double = false;
+         STRUC_THROW(std::system_error(
+            std::make_error_code(std::io_errc::stream), "reader"));
       }
+      n = static_cast<size_t>(is->gcount());
    }
-   return is_ieee_double;
+   filled += n;
+   eof = n == 0;
+   return true;
 }
 
-template <typename F>
-inline typename std::enable_if<!std::is_same<F, float>::value
-                                  && !std::is_same<F, double>::value,
-                               bool>::type
-   struc::is_ieee()
+inline struc::reader::iterator::iterator(reader* r_)
+: r(r_)
 {
-   throw std::runtime_error(
-      "Internal error: Only float or double allowed for ieee check");
 }
 
-template <typename F>
-inline typename std::enable_if<std::is_same<F, float>::value, void>::type
-   struc::pack_non_ieee(bool litte_endian, char* buffer, size_t& offset, F f)
+inline struc::reader::iterator::reference struc::reader::iterator::operator*()
+   const
 {
-   uint8_t sign = f < 0 ? 1 : 0;
-   if (sign)
+   return r->current;
+}
+
+inline struc::reader::iterator::pointer struc::reader::iterator::operator->()
+   const
+{
+   return &r->current;
+}
+
+inline struc::reader::iterator& struc::reader::iterator::operator++()
+{
+   if (!r->next(r->current))
    {
-      f = -f;
+      r = nullptr;
    }
-   int e;
-   auto d = std::frexp(f, &e);
-   if (0.5 <= d && d < 1.0)
+   return *this;
+}
+
+inline bool struc::reader::iterator::operator==(const iterator& other) const
+{
+   return r == other.r;
+}
+
+inline bool struc::reader::iterator::operator!=(const iterator& other) const
+{
+   return r != other.r;
+}
+
+#ifdef STRUC_POSIX
+inline struc::writer::writer(const struc& s_,
+                             int fd_,
+                             size_t buffer_size,
+                             sync_policy policy_)
+: s(&s_)
+, fd(fd_)
+, policy(policy_)
+, buffer(std::max(buffer_size, s_.record_stride))
+, pos(0)
+{
+}
+
+inline struc::writer::~writer()
+{
+   write_all(nullptr, 0);
+}
+
+template <typename... T>
+inline void struc::writer::write(const T&... t)
+{
+   reserve();
+   s->pack_into(buffer.data(), buffer.size(), pos, t...);
+   commit();
+}
+
+template <typename... T>
+inline void struc::writer::write(const std::tuple<T...>& t)
+{
+   reserve();
+   s->pack_into(buffer.data(), buffer.size(), pos, t);
+   commit();
+}
+
+inline void struc::writer::write_bytes(const char* data, size_t length)
+{
+   if (buffer.size() - pos >= length)
    {
-      d *= 2.0;
-      e--;
+      std::memcpy(buffer.data() + pos, data, length);
+      pos += length;
+      return;
    }
-   else if (d == 0.0)
+   if (int e = write_all(data, length))
    {
-      e = 0;
+      STRUC_THROW(std::system_error(e, std::generic_category(), "writer"));
    }
-   else
+}
+
+inline void struc::writer::flush()
+{
+   if (int e = write_all(nullptr, 0))
    {
-      throw std::runtime_error("frexp() result is out of range");
+      STRUC_THROW(std::system_error(e, std::generic_category(), "writer"));
    }
-   if (e >= 128)
+   if (policy == sync_policy::every_flush)
    {
-      throw std::overflow_error("float is too large to pack into ieee format");
+      sync();
    }
-   else if (e < -126)
+}
+
+inline void struc::writer::sync()
+{
+   if (int e = write_all(nullptr, 0))
    {
-      d = std::ldexp(d, 126 + e);
-      e = 0;
+      STRUC_THROW(std::system_error(e, std::generic_category(), "writer"));
    }
-   else if (!(e == 0 && d == 0.0))
+   if (::fsync(fd) != 0)
    {
-      e += 127;
-      d -= 1.0;
+      STRUC_THROW(
+         std::system_error(errno, std::generic_category(), "writer"));
    }
-   d *= 8388608.0;
-   uint32_t bits = static_cast<uint32_t>(d + 0.5);
-   if (bits >> 23 > 0)
+}
+
+inline size_t struc::writer::buffered() const
+{
+   return pos;
+}
+
+inline void struc::writer::reserve()
+{
+   if (buffer.size() - pos < s->record_stride)
    {
-      bits = 0;
-      ++e;
-      if (e >= 255)
-      {
-         throw std::overflow_error(
-            "float is too large to pack into ieee format");
-      }
+      flush();
    }
-   if (litte_endian)
+}
+
+inline void struc::writer::commit()
+{
+   // write_bytes may have left anything in the trailing padding
+   std::memset(buffer.data() + pos + s->size, 0, s->record_stride - s->size);
+   pos += s->record_stride;
+}
+
+inline int struc::writer::write_all(const char* data, size_t length)
+{
+   if (pos == 0 && length == 0)
    {
-      buffer[offset + 3] = static_cast<char>((sign << 7) | (e >> 1));
-      buffer[offset + 2] = static_cast<char>(
-         ((static_cast<unsigned int>(e) & 0x1) << 7) | (bits >> 16));
-      buffer[offset + 1] = static_cast<char>((bits >> 8) & 0xff);
-      buffer[offset] = static_cast<char>(bits & 0xff);
+      return 0;
    }
-   else
+   iovec iov[2] = {{buffer.data(), pos}, {const_cast<char*>(data), length}};
+   size_t written = 0;
+   int e = write_iov(fd, iov, length > 0 ? 2 : 1, written);
+   // keep whatever was not written of the buffer
+   size_t left = written < pos ? pos - written : 0;
+   std::memmove(buffer.data(), buffer.data() + pos - left, left);
+   pos = left;
+   return e;
+}
+
+inline struc::async_writer::async_writer(const struc& s_,
+                                         int fd_,
+                                         size_t buffer_size,
+                                         size_t buffers)
+: s(&s_)
+, fd(fd_)
+, active(std::max(buffer_size, s_.record_stride))
+, pos(0)
+, depth(0)
+, stall_count(0)
+, error(0)
+, writing(false)
+, stopping(false)
+{
+   for (size_t k = 1; k < std::max<size_t>(buffers, 2); ++k)
    {
-      buffer[offset] = static_cast<char>((sign << 7) | (e >> 1));
-      buffer[offset + 1] = static_cast<char>(
-         ((static_cast<unsigned int>(e) & 0x1) << 7) | (bits >> 16));
-      buffer[offset + 2] = static_cast<char>((bits >> 8) & 0xff);
-      buffer[offset + 3] = static_cast<char>(bits & 0xff);
+      empty.emplace_back(active.size());
    }
-   offset += 4;
+   thread = std::thread(&async_writer::run, this);
 }
 
-template <typename F>
-inline typename std::enable_if<std::is_same<F, double>::value, void>::type
-   struc::pack_non_ieee(bool litte_endian, char* buffer, size_t& offset, F f)
+inline struc::async_writer::~async_writer()
 {
-   uint8_t sign = f < 0 ? 1 : 0;
-   if (sign)
    {
-      f = -f;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (pos > 0 && error == 0)
+      {
+         full.emplace_back(std::move(active), pos);
+         ++depth;
+      }
+      stopping = true;
    }
-   int e;
-   auto d = std::frexp(f, &e);
-   if (0.5 <= d && d < 1.0)
+   ready.notify_one();
+   thread.join();
+}
+
+template <typename... T>
+inline void struc::async_writer::write(const T&... t)
+{
+   reserve();
+   s->pack_into(active.data(), active.size(), pos, t...);
+   commit();
+}
+
+template <typename... T>
+inline void struc::async_writer::write(const std::tuple<T...>& t)
+{
+   reserve();
+   s->pack_into(active.data(), active.size(), pos, t);
+   commit();
+}
+
+inline void struc::async_writer::flush()
+{
+   std::unique_lock<std::mutex> lock(mutex);
+   if (pos > 0)
    {
-      d *= 2.0;
-      e--;
+      hand_off(lock);
    }
-   else if (d == 0.0)
+   drained.wait(lock, [this]() { return full.empty() && !writing; });
+   if (error != 0)
    {
-      e = 0;
+      STRUC_THROW(
+         std::system_error(error, std::generic_category(), "async_writer"));
    }
-   else
+}
+
+inline void struc::async_writer::sync()
+{
+   flush();
+   if (::fsync(fd) != 0)
    {
-      throw std::runtime_error("frexp() result is out of range");
+      STRUC_THROW(
+         std::system_error(errno, std::generic_category(), "async_writer"));
    }
-   if (e >= 1024)
+}
+
+inline size_t struc::async_writer::queue_depth() const
+{
+   return depth;
+}
+
+inline size_t struc::async_writer::stalls() const
+{
+   return stall_count;
+}
+
+inline void struc::async_writer::reserve()
+{
+   if (active.size() - pos < s->record_stride)
    {
-      throw std::overflow_error("double is too large to pack into ieee format");
+      std::unique_lock<std::mutex> lock(mutex);
+      hand_off(lock);
    }
-   else if (e < -1022)
+}
+
+inline void struc::async_writer::commit()
+{
+   std::memset(active.data() + pos + s->size, 0, s->record_stride - s->size);
+   pos += s->record_stride;
+}
+
+inline void struc::async_writer::hand_off(std::unique_lock<std::mutex>& lock)
+{
+   if (error == 0)
    {
-      d = std::ldexp(d, 1022 + e);
-      e = 0;
+      full.emplace_back(std::move(active), pos);
+      ++depth;
+      ready.notify_one();
+      if (empty.empty())
+      {
+         // back pressure, every buffer is waiting to be written
+         ++stall_count;
+         drained.wait(lock, [this]() { return !empty.empty(); });
+      }
+      active = std::move(empty.back());
+      empty.pop_back();
    }
-   else if (!(e == 0 && d == 0.0))
+   pos = 0;
+   if (error != 0)
    {
-      e += 1023;
-      d -= 1.0;
+      STRUC_THROW(
+         std::system_error(error, std::generic_category(), "async_writer"));
    }
-   d *= 268435456.0;
-   uint32_t hi = static_cast<uint32_t>(d);
-   d -= static_cast<double>(hi);
-   d *= 16777216.0;
-   uint32_t lo = static_cast<uint32_t>(d + 0.5);
-   if (lo >> 24 > 0)
+}
+
+inline void struc::async_writer::run()
+{
+   std::unique_lock<std::mutex> lock(mutex);
+   for (;;)
    {
-      lo = 0;
-      ++hi;
-      if (hi >> 28 > 0)
+      ready.wait(lock, [this]() { return !full.empty() || stopping; });
+      if (full.empty())
       {
-         hi = 0;
-         ++e;
-         if (e >= 2047)
-         {
-            throw std::overflow_error(
-               "double is too large to pack into ieee format");
-         }
+         return;
+      }
+      auto b = std::move(full.front());
+      full.pop_front();
+      writing = true;
+      // after a failure, buffers are only recycled
+      bool failed = error != 0;
+      lock.unlock();
+      iovec iov = {b.first.data(), b.second};
+      size_t written = 0;
+      int e = failed ? 0 : write_iov(fd, &iov, 1, written);
+      lock.lock();
+      writing = false;
+      --depth;
+      if (e != 0)
+      {
+         error = e;
       }
+      empty.push_back(std::move(b.first));
+      drained.notify_all();
    }
-   if (litte_endian)
+}
+#endif
+
+inline struc::decoder::decoder(const struc& s_,
+                               std::function<void(const view&)> on_record_)
+: s(&s_)
+, on_record(std::move(on_record_))
+, partial(s_.size)
+, held(0)
+{
+   check_record_size("decoder", s_.size);
+}
+
+inline size_t struc::decoder::feed(const char* data, size_t length)
+{
+   const size_t size = s->size;
+   const size_t stride = s->record_stride;
+   size_t n = 0;
+   if (held > 0)
    {
-      buffer[offset + 7] = static_cast<char>((sign << 7) | (e >> 4));
-      buffer[offset + 6] = static_cast<char>(
-         ((static_cast<uint32_t>(e) & 0xf) << 4) | (hi >> 24));
-      buffer[offset + 5] = static_cast<char>((hi >> 16) & 0xff);
-      buffer[offset + 4] = static_cast<char>((hi >> 8) & 0xff);
-      buffer[offset + 3] = static_cast<char>(hi & 0xff);
-      buffer[offset + 2] = static_cast<char>((lo >> 16) & 0xff);
-      buffer[offset + 1] = static_cast<char>((lo >> 8) & 0xff);
-      buffer[offset] = static_cast<char>(lo & 0xff);
+      if (held < size)
+      {
+         size_t m = std::min(length, size - held);
+         std::memcpy(partial.data() + held, data, m);
+         held += m;
+         data += m;
+         length -= m;
+         if (held < size)
+         {
+            return 0;
+         }
+         on_record(view(*s, partial.data()));
+         ++n;
+      }
+      size_t padding = std::min(length, stride - held);
+      held += padding;
+      data += padding;
+      length -= padding;
+      if (held < stride)
+      {
+         return n;
+      }
+      held = 0;
    }
-   else
+   while (length >= size)
    {
-      buffer[offset] = static_cast<char>((sign << 7) | (e >> 4));
-      buffer[offset + 1] = static_cast<char>(
-         ((static_cast<uint32_t>(e) & 0xf) << 4) | (hi >> 24));
-      buffer[offset + 2] = static_cast<char>((hi >> 16) & 0xff);
-      buffer[offset + 3] = static_cast<char>((hi >> 8) & 0xff);
-      buffer[offset + 4] = static_cast<char>(hi & 0xff);
-      buffer[offset + 5] = static_cast<char>((lo >> 16) & 0xff);
-      buffer[offset + 6] = static_cast<char>((lo >> 8) & 0xff);
-      buffer[offset + 7] = static_cast<char>(lo & 0xff);
+      on_record(view(*s, data));
+      ++n;
+      size_t m = std::min(length, stride);
+      data += m;
+      length -= m;
+      if (m < stride)
+      {
+         // the padding of this record is still to come
+         held = m;
+         return n;
+      }
    }
-   offset += 8;
+   std::memcpy(partial.data(), data, length);
+   held = length;
+   return n;
 }
 
-template <typename F>
-inline typename std::enable_if<!std::is_same<F, float>::value
-                                  && !std::is_same<F, double>::value,
-                               void>::type
-   struc::pack_non_ieee(bool, char*, size_t&, F)
+inline size_t struc::decoder::pending() const
 {
-   throw std::runtime_error(
-      "Internal error: Only float or double allowed for ieee packing");
+   return held < s->size ? held : 0;
 }
 
-template <typename I, typename T, typename U>
-inline typename std::enable_if<std::is_integral<T>::value, void>::type
-   struc::pack_native(char* buffer, size_t& offset, const I& i)
+inline void struc::decoder::reset()
 {
-   T i_ = static_cast<T>(i);
-   size_t pad = padding<T>(offset);
-   if (pad > 0)
-   {
-      offset += pad;
-   }
-   std::memcpy(buffer + offset, &i_, sizeof(i_));
-   offset += sizeof(i_);
+   held = 0;
 }
 
-template <typename F, typename T, typename U>
-inline typename std::enable_if<std::is_floating_point<T>::value, void>::type
-   struc::pack_native(char* buffer, size_t& offset, const F& f)
+inline struc::framer::framer(const struc& header,
+                             size_t length_index_,
+                             callback on_frame_,
+                             size_t max_payload_,
+                             bool includes_header_,
+                             size_t capacity)
+: s(&header)
+, length_index(length_index_)
+, on_frame(std::move(on_frame_))
+, max_payload(max_payload_)
+, includes_header(includes_header_)
+, pos(0)
+, filled(0)
 {
-   T f_ = static_cast<T>(f);
-   size_t pad = padding<T>(offset);
-   if (pad > 0)
+   size_t offset;
+   auto f = header.item_field(length_index, offset);
+   status st = status();
+   st.index = length_index;
+   if (!f)
    {
-      offset += pad;
+      fail(st, errc::index_out_of_range);
+      raise("framer", st, 'x');
    }
-   if (is_ieee<T>())
+   if (!std::strchr("bBhHiIlLqQ", f->type))
    {
-      std::memcpy(buffer + offset, &f_, sizeof(f_));
-      offset += sizeof(f_);
+      fail(st, errc::illegal_type);
+      raise("framer", st, f->type);
    }
-   else
+   const size_t max = std::numeric_limits<size_t>::max();
+   if (max_payload > max - header.size)
    {
-#ifdef BOOST_BIG_ENDIAN
-      pack_non_ieee<T>(false, buffer, offset, f_);
-#else
-      pack_non_ieee<T>(true, buffer, offset, f_);
-#endif
+      STRUC_THROW(std::length_error("framer: max_payload is too large"));
+   }
+   size_t frame = header.size + max_payload;
+   if (capacity == 0)
+   {
+      capacity = frame <= max / 2 ? 2 * frame : frame;
    }
+   buffer.resize(std::max(capacity, frame));
 }
 
-template <typename I, typename T, typename U>
-inline typename std::enable_if<std::is_integral<T>::value, void>::type
-   struc::pack_non_native(control c, char* buffer, size_t& offset, const I& i)
+inline char* struc::framer::prepare(size_t& space)
 {
-   T i_ = static_cast<T>(i);
-   to_endian(c, i_);
-   std::memcpy(buffer + offset, &i_, sizeof(i_));
-   offset += sizeof(i_);
+   if (pos > 0)
+   {
+      std::memmove(buffer.data(), buffer.data() + pos, filled - pos);
+      filled -= pos;
+      pos = 0;
+   }
+   space = buffer.size() - filled;
+   return buffer.data() + filled;
 }
 
-template <typename F, typename T, typename U>
-inline typename std::enable_if<std::is_floating_point<T>::value, void>::type
-   struc::pack_non_native(control c, char* buffer, size_t& offset, const F& f)
+inline void struc::framer::commit(size_t length)
 {
-   static_assert(sizeof(T) == sizeof(U), "Types T and U must have equal size");
-   T f_ = static_cast<T>(f);
-   if (is_ieee<T>())
-   {
-      U* i = reinterpret_cast<U*>(&f_);
-      to_endian(c, *i);
-      std::memcpy(buffer + offset, &f_, sizeof(f_));
-      offset += sizeof(f_);
-   }
-   else
-   {
-      pack_non_ieee<T>(c == litte_endian, buffer, offset, f_);
-   }
+   filled += length;
 }
 
-template <typename I>
-inline typename std::enable_if<std::is_arithmetic<I>::value, void>::type
-   struc::pack_scalar(control c,
-                      std::pair<size_t, char>& cur,
-                      char* buffer,
-                      size_t& offset,
-                      const I& i)
+inline size_t struc::framer::drain(size_t max_frames)
 {
-   switch (cur.second)
+   size_t n = 0;
+   for (; n < max_frames && filled - pos >= s->size; ++n)
    {
-   case 'c':
-   case 'b':
-   case 'B':
-   case '?':
-      std::memcpy(buffer + offset, &i, 1);
-      offset += 1;
-      break;
-   case 'h':
-      c == native ? pack_native<I, short>(buffer, offset, i) :
-                    pack_non_native<I, int16_t>(c, buffer, offset, i);
-      break;
-   case 'H':
-      c == native ? pack_native<I, unsigned short>(buffer, offset, i) :
-                    pack_non_native<I, uint16_t>(c, buffer, offset, i);
-      break;
-   case 'i':
-      c == native ? pack_native<I, int>(buffer, offset, i) :
-                    pack_non_native<I, int32_t>(c, buffer, offset, i);
-      break;
-   case 'I':
-      c == native ? pack_native<I, unsigned int>(buffer, offset, i) :
-                    pack_non_native<I, uint32_t>(c, buffer, offset, i);
-      break;
-   case 'l':
-      c == native ? pack_native<I, long>(buffer, offset, i) :
-                    pack_non_native<I, int32_t>(c, buffer, offset, i);
-      break;
-   case 'L':
-      c == native ? pack_native<I, unsigned long>(buffer, offset, i) :
-                    pack_non_native<I, uint32_t>(c, buffer, offset, i);
-      break;
-   case 'q':
-      c == native ? pack_native<I, long long>(buffer, offset, i) :
-                    pack_non_native<I, int64_t>(c, buffer, offset, i);
-      break;
-   case 'Q':
-      c == native ? pack_native<I, unsigned long long>(buffer, offset, i) :
-                    pack_non_native<I, uint64_t>(c, buffer, offset, i);
-      break;
-   case 'f':
-      c == native ? pack_native<I, float>(buffer, offset, i) :
-                    pack_non_native<I, float, uint32_t>(c, buffer, offset, i);
-      break;
-   case 'd':
-      c == native ? pack_native<I, double>(buffer, offset, i) :
-                    pack_non_native<I, double, uint64_t>(c, buffer, offset, i);
-      break;
-   default:
-      throw std::logic_error(std::string("Encountered illegal type: ")
-                             + cur.second);
+      view header(*s, buffer.data() + pos);
+      auto length = header.get<unsigned long long>(length_index);
+      if (includes_header ? length < s->size || length - s->size > max_payload
+                          : length > max_payload)
+      {
+         STRUC_THROW(std::length_error("framer: frame length "
+                                       + std::to_string(length)
+                                       + " is out of range"));
+      }
+      if (includes_header)
+      {
+         length -= s->size;
+      }
+      if (filled - pos - s->size < length)
+      {
+         break;
+      }
+      on_frame(header,
+               buffer.data() + pos + s->size,
+               static_cast<size_t>(length));
+      pos += s->size + static_cast<size_t>(length);
    }
-   cur.first--;
+   return n;
 }
 
-template <typename A>
-inline
-   typename std::enable_if<std::is_array<A>::value
-                              && !std::is_constructible<std::string, A>::value,
-                           void>::type
-   struc::pack_scalar(control c,
-                      std::pair<size_t, char>& cur,
-                      char* buffer,
-                      size_t& offset,
-                      const A& a)
+inline size_t struc::framer::pending() const
 {
-   if (std::extent<A>::value < cur.first)
-   {
-      throw std::underflow_error(std::string("Provided array too small (")
-                                 + std::to_string(std::extent<A>::value)
-                                 + "), expected "
-                                 + std::to_string(cur.first));
-   }
-   else if (std::extent<A>::value > cur.first)
-   {
-      throw std::overflow_error(std::string("Provided array too large (")
-                                + std::to_string(std::extent<A>::value)
-                                + "), expected "
-                                + std::to_string(cur.first));
-   }
-   for (size_t i = 0; i < std::extent<A>::value; ++i)
+   return filled - pos;
+}
+
+#ifdef STRUC_POSIX
+inline int struc::write_iov(int fd, iovec* iov, int count, size_t& written)
+{
+   // resumed after short writes
+   while (count > 0)
    {
-      pack_scalar(c, cur, buffer, offset, a[i]);
+      ssize_t r = ::writev(fd, iov, count);
+      if (r < 0)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+         return errno;
+      }
+      size_t n = static_cast<size_t>(r);
+      written += n;
+      while (count > 0 && n >= iov->iov_len)
+      {
+         n -= iov->iov_len;
+         ++iov;
+         --count;
+      }
+      if (count > 0)
+      {
+         iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+         iov->iov_len -= n;
+      }
    }
+   return 0;
 }
+#endif
 
-template <typename S>
-inline typename std::enable_if<std::is_constructible<std::string, S>::value
-                                  && !std::is_null_pointer<S>::value,
-                               void>::type
-   struc::pack_scalar(control c,
-                      std::pair<size_t, char>& cur,
-                      char* buffer,
-                      size_t& offset,
-                      const S& s)
+template <typename V>
+inline struc::records<V>::records(const V& first_,
+                                  size_t stride_,
+                                  size_t count_)
+: first(first_)
+, stride(stride_)
+, count(count_)
 {
-   switch (cur.second)
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator struc::records<V>::begin() const
+{
+   return iterator(first, stride);
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator struc::records<V>::end() const
+{
+   return begin() + static_cast<std::ptrdiff_t>(count);
+}
+
+template <typename V>
+inline size_t struc::records<V>::size() const
+{
+   return count;
+}
+
+template <typename V>
+inline bool struc::records<V>::empty() const
+{
+   return count == 0;
+}
+
+template <typename V>
+inline V struc::records<V>::operator[](size_t n) const
+{
+   return begin()[static_cast<std::ptrdiff_t>(n)];
+}
+
+template <typename V>
+inline struc::records<V>::iterator::iterator(const V& v_, size_t stride_)
+: v(v_)
+, stride(static_cast<std::ptrdiff_t>(stride_))
+{
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator::reference
+   struc::records<V>::iterator::operator*() const
+{
+   return v;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator::pointer
+   struc::records<V>::iterator::operator->() const
+{
+   return arrow(v);
+}
+
+template <typename V>
+inline struc::records<V>::iterator::arrow::arrow(const V& v_)
+: v(v_)
+{
+}
+
+template <typename V>
+inline const V* struc::records<V>::iterator::arrow::operator->() const
+{
+   return &v;
+}
+
+template <typename V>
+inline V struc::records<V>::iterator::operator[](difference_type n) const
+{
+   return *(*this + n);
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator&
+   struc::records<V>::iterator::operator++()
+{
+   v.buffer += stride;
+   return *this;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator
+   struc::records<V>::iterator::operator++(int)
+{
+   iterator i(*this);
+   v.buffer += stride;
+   return i;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator&
+   struc::records<V>::iterator::operator--()
+{
+   v.buffer -= stride;
+   return *this;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator
+   struc::records<V>::iterator::operator--(int)
+{
+   iterator i(*this);
+   v.buffer -= stride;
+   return i;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator&
+   struc::records<V>::iterator::operator+=(difference_type n)
+{
+   v.buffer += n * stride;
+   return *this;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator&
+   struc::records<V>::iterator::operator-=(difference_type n)
+{
+   v.buffer -= n * stride;
+   return *this;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator
+   struc::records<V>::iterator::operator+(difference_type n) const
+{
+   iterator i(*this);
+   return i += n;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator
+   struc::records<V>::iterator::operator-(difference_type n) const
+{
+   iterator i(*this);
+   return i -= n;
+}
+
+template <typename V>
+inline typename struc::records<V>::iterator::difference_type
+   struc::records<V>::iterator::operator-(const iterator& other) const
+{
+   return stride == 0 ? 0 : (v.buffer - other.v.buffer) / stride;
+}
+
+template <typename V>
+inline bool struc::records<V>::iterator::operator==(
+   const iterator& other) const
+{
+   return v.buffer == other.v.buffer;
+}
+
+template <typename V>
+inline bool struc::records<V>::iterator::operator!=(
+   const iterator& other) const
+{
+   return v.buffer != other.v.buffer;
+}
+
+template <typename V>
+inline bool struc::records<V>::iterator::operator<(
+   const iterator& other) const
+{
+   return v.buffer < other.v.buffer;
+}
+
+template <typename V>
+inline bool struc::records<V>::iterator::operator>(
+   const iterator& other) const
+{
+   return v.buffer > other.v.buffer;
+}
+
+template <typename V>
+inline bool struc::records<V>::iterator::operator<=(
+   const iterator& other) const
+{
+   return v.buffer <= other.v.buffer;
+}
+
+template <typename V>
+inline bool struc::records<V>::iterator::operator>=(
+   const iterator& other) const
+{
+   return v.buffer >= other.v.buffer;
+}
+
+template <size_t N>
+inline constexpr char struc::pattern_at(const char (&pattern)[N], size_t i)
+{
+   return N > 65 ? pattern_too_long() : (i < N ? pattern[i] : '\0');
+}
+
+inline char struc::pattern_too_long()
+{
+   STRUC_THROW(std::length_error("Pattern too long for STRUC_FIXED"));
+}
+
+template <size_t... I, size_t... J>
+struct struc::concat_indices<struc::indices<I...>, struc::indices<J...>>
+{
+   typedef indices<I..., (sizeof...(I) + J)...> type;
+};
+
+template <size_t N, typename D>
+struct struc::make_indices
+   : concat_indices<typename make_indices<N / 2>::type,
+                    typename make_indices<N - N / 2>::type>
+{
+};
+
+template <typename D>
+struct struc::make_indices<0, D>
+{
+   typedef indices<> type;
+};
+
+template <typename D>
+struct struc::make_indices<1, D>
+{
+   typedef indices<0> type;
+};
+
+template <char T, size_t O, size_t S>
+struct struc::item
+{
+   typedef typename code<T>::value_type value_type;
+   static constexpr size_t offset = O;
+   static constexpr size_t size = S;
+   static constexpr size_t alignment = code<T>::alignment;
+
+   template <control C, typename A>
+   static void pack(char* buffer, const A& a)
    {
-   case 's':
-   case 'p':
+      code<T>::template pack<C, O, S>(buffer, a);
+   }
+
+   template <control C, typename A>
+   static void unpack(const char* buffer, A& a)
    {
-      std::string s_(s);
-      std::memcpy(buffer + offset, s_.data(), s_.size());
-      offset += s_.size();
-      cur.first--;
-      break;
+      code<T>::template unpack<C, O, S>(buffer, a);
    }
-   case 'c':
+};
+
+template <typename... I, typename... J>
+struct struc::concat_items<struc::item_list<I...>, struc::item_list<J...>>
+{
+   typedef item_list<I..., J...> type;
+};
+
+template <char T, size_t O, size_t S, size_t... I>
+struct struc::run<T, O, S, struc::indices<I...>>
+{
+   typedef item_list<item<T, O + I * S, S>...> type;
+};
+
+template <typename N, typename E>
+struct struc::integer_code
+{
+   typedef N value_type;
+   static constexpr bool valid = true;
+   static constexpr size_t native_size = sizeof(N);
+   static constexpr size_t standard_size = sizeof(E);
+   static constexpr size_t alignment = alignof(N);
+
+   template <control C, size_t O, size_t S, typename I>
+   static void pack(char* buffer, const I& i)
    {
-      if (!std::is_array<S>::value)
-      {
-         throw std::logic_error("Expected array of char");
-      }
-      if (std::extent<S>::value < cur.first)
-      {
-         throw std::underflow_error(std::string("Provided array too small (")
-                                    + std::to_string(std::extent<S>::value)
-                                    + "), expected "
-                                    + std::to_string(cur.first));
-      }
-      else if (std::extent<S>::value > cur.first)
+      static_assert(std::is_arithmetic<I>::value,
+                    "Expected arithmetic type for integer format");
+      size_t offset = O;
+      if (C == native)
       {
-         throw std::overflow_error(std::string("Provided array too large (")
-                                   + std::to_string(std::extent<S>::value)
-                                   + "), expected "
-                                   + std::to_string(cur.first));
+         pack_native<I, N>(buffer, offset, i);
       }
-      for (size_t i = 0; i < std::extent<S>::value; ++i)
+      else
       {
-         pack_scalar(c, cur, buffer, offset, s[i]);
+         pack_non_native<I, E>(C, buffer, offset, i);
       }
-      break;
-   }
-   default:
-      throw std::logic_error(std::string("Encountered illegal type: ")
-                             + cur.second);
    }
-}
 
-template <typename P>
-inline
-   typename std::enable_if<(std::is_pointer<P>::value
-                            && !std::is_constructible<std::string, P>::value)
-                              || std::is_null_pointer<P>::value
-                              || std::is_member_pointer<P>::value,
-                           void>::type
-   struc::pack_scalar(control c,
-                      std::pair<size_t, char>& cur,
-                      char* buffer,
-                      size_t& offset,
-                      const P& p)
-{
-   if (cur.second == 'P')
+   template <control C, size_t O, size_t S, typename I>
+   static void unpack(const char* buffer, I& i)
    {
-      if (c == native)
+      static_assert(std::is_arithmetic<I>::value,
+                    "Expected arithmetic type for integer format");
+      size_t offset = O;
+      if (C == native)
       {
-         void* p_ = static_cast<void*>(p);
-         size_t pad = padding<void*>(offset);
-         if (pad > 0)
-         {
-            offset += pad;
-         }
-         std::memcpy(buffer + offset, &p_, sizeof(p_));
-         offset += sizeof(p_);
-         cur.first--;
+         unpack_native<I, N>(buffer, offset, i);
       }
       else
       {
-         throw std::logic_error(
-            std::string("native byte order is required for the P format"));
+         unpack_non_native<I, E>(C, buffer, offset, i);
       }
    }
-   else
-   {
-      throw std::logic_error(std::string("Encountered illegal type: ")
-                             + cur.second);
-   }
-}
+};
 
-template <typename T>
-inline size_t struc::pack_helper(std::pair<size_t, size_t>& pos,
-                                 std::pair<size_t, char>& cur,
-                                 char*& buffer,
-                                 size_t& offset,
-                                 const T& t) const
+template <typename F, typename U>
+struct struc::float_code
 {
-   if (cur.first > 0)
-   {
-      pack_scalar(c, cur, buffer, offset, t);
-      auto alignment = c == native ? native_alignment(cur.second) : 0;
-      pos.second = std::max(pos.second, alignment);
-      return 1;
-   }
-   cur.first = 1;
-   std::ostringstream ss;
-   while (pos.first < pattern.size())
+   typedef F value_type;
+   static constexpr bool valid = true;
+   static constexpr size_t native_size = sizeof(F);
+   static constexpr size_t standard_size = sizeof(F);
+   static constexpr size_t alignment = alignof(F);
+
+   template <control C, size_t O, size_t S, typename A>
+   static void pack(char* buffer, const A& a)
    {
-      cur.second = pattern[pos.first++];
-      if (std::isspace(cur.second))
-      {
-         continue;
-      }
-      if (std::isdigit(cur.second))
+      static_assert(std::is_arithmetic<A>::value,
+                    "Expected arithmetic type for floating point format");
+      status st = status();
+      size_t offset = O;
+      bool ok;
+      if (C == native)
       {
-         ss << cur.second;
-         continue;
+         ok = pack_native<A, F>(buffer, offset, st, a);
       }
-      auto n = ss.str();
-      ss.clear();
-      ss.str("");
-      if (n.size() > 0)
+      else
       {
-         try
-         {
-            cur.first = std::stoul(n);
-         }
-         catch (...)
-         {
-            cur.first = 1;
-         }
+         ok = pack_non_native<A, F, U>(C, buffer, offset, st, a);
       }
-      if (cur.second == 'x')
+      if (!ok)
       {
-         offset += cur.first;
-         cur.first = 1;
-         continue;
+         raise("pack", st, std::is_same<F, float>::value ? 'f' : 'd');
       }
-      else if (cur.second == 's' || cur.second == 'p')
+   }
+
+   template <control C, size_t O, size_t S, typename A>
+   static void unpack(const char* buffer, A& a)
+   {
+      static_assert(std::is_arithmetic<A>::value,
+                    "Expected arithmetic type for floating point format");
+      status st = status();
+      size_t offset = O;
+      bool ok;
+      if (C == native)
       {
-         check_scalar(cur.first, t);
-         cur.first = 1;
+         ok = unpack_native<A, F>(buffer, offset, st, a);
       }
-      if (cur.first > 0)
+      else
       {
-         pack_scalar(c, cur, buffer, offset, t);
-         auto alignment = c == native ? native_alignment(cur.second) : 0;
-         pos.second = std::max(pos.second, alignment);
+         ok = unpack_non_native<A, F, U>(C, buffer, offset, st, a);
       }
-      else if (c == native)
+      if (!ok)
       {
-         offset += native_padding(offset, cur.second);
-         pos.second = std::max(pos.second, native_alignment(cur.second));
-         continue;
+         raise("unpack", st, std::is_same<F, float>::value ? 'f' : 'd');
       }
-      return 1;
    }
-   return 0;
-}
+};
 
-template <typename T, typename... Ts>
-inline size_t struc::pack_helper(std::pair<size_t, size_t>& pos,
-                                 std::pair<size_t, char>& cur,
-                                 char*& buffer,
-                                 size_t& offset,
-                                 const T& t,
-                                 const Ts&... ts) const
+template <typename B>
+struct struc::byte_code
 {
-   auto sz = pack_helper(pos, cur, buffer, offset, t);
-   sz += pack_helper(pos, cur, buffer, offset, ts...);
-   return sz;
-}
+   typedef B value_type;
+   static constexpr bool valid = true;
+   static constexpr size_t native_size = 1;
+   static constexpr size_t standard_size = 1;
+   static constexpr size_t alignment = 1;
 
-template <typename... T>
-inline void struc::pack(char* buffer, const T&... t) const
-{
-   size_t no_of_items, offset = 0;
-   std::pair<size_t, size_t> pos(0, 1);
-   std::pair<size_t, char> cur(0, 'x');
-   auto packed_items = pack_helper(pos, cur, buffer, offset, t...);
-   if (packed_items < sizeof...(T))
+   template <control C, size_t O, size_t S, typename I>
+   static void pack(char* buffer, const I& i)
    {
-      throw std::overflow_error(std::string("Extra ")
-                                + std::to_string(sizeof...(T)-packed_items)
-                                + " arguments to pack");
+      static_assert(std::is_arithmetic<I>::value,
+                    "Expected arithmetic type for byte format");
+      buffer[O] = static_cast<char>(static_cast<B>(i));
    }
-   calcsize_helper(pos, no_of_items);
-   no_of_items += cur.first;
-   if (no_of_items > 0)
+
+   template <control C, size_t O, size_t S, typename I>
+   static void unpack(const char* buffer, I& i)
    {
-      throw std::underflow_error(std::string("Missing ")
-                                 + std::to_string(no_of_items)
-                                 + " arguments to pack");
+      static_assert(std::is_arithmetic<I>::value,
+                    "Expected arithmetic type for byte format");
+      i = static_cast<I>(static_cast<B>(buffer[O]));
    }
-}
-
-template <typename... T>
-inline std::vector<char> struc::pack(const std::string& pattern, const T&... t)
-{
-   struc s(pattern);
-   std::vector<char> v(s.calcsize(), '\0');
-   s.pack(&v[0], t...);
-   return v;
-}
-
-template <size_t I, typename... T>
-inline typename std::enable_if<I == sizeof...(T), size_t>::type
-   struc::pack_helper_t(std::pair<size_t, size_t>&,
-                        std::pair<size_t, char>&,
-                        char*&,
-                        size_t&,
-                        const std::tuple<T...>&) const
-{
-   return 0;
-}
+};
 
-template <size_t I, typename... T>
-   inline typename std::enable_if
-   < I<sizeof...(T), size_t>::type struc::pack_helper_t(
-        std::pair<size_t, size_t>& pos,
-        std::pair<size_t, char>& cur,
-        char*& buffer,
-        size_t& offset,
-        const std::tuple<T...>& t) const
+struct struc::string_code
 {
-   auto sz = pack_helper(pos, cur, buffer, offset, std::get<I>(t));
-   sz += pack_helper_t<I + 1, T...>(pos, cur, buffer, offset, t);
-   return sz;
-}
+   typedef std::string value_type;
+   static constexpr bool valid = true;
+   static constexpr size_t native_size = 1;
+   static constexpr size_t standard_size = 1;
+   static constexpr size_t alignment = 1;
 
-template <typename... T>
-inline void struc::pack(char* buffer, const std::tuple<T...>& t) const
-{
-   size_t no_of_items, offset = 0;
-   std::pair<size_t, size_t> pos(0, 1);
-   std::pair<size_t, char> cur(0, 'x');
-   auto packed_items = pack_helper_t(pos, cur, buffer, offset, t);
-   if (packed_items < sizeof...(T))
-   {
-      throw std::overflow_error(std::string("Extra ")
-                                + std::to_string(sizeof...(T)-packed_items)
-                                + " arguments to pack");
-   }
-   calcsize_helper(pos, no_of_items);
-   no_of_items += cur.first;
-   if (no_of_items > 0)
+   template <control C, size_t O, size_t S, typename A>
+   static void pack(char* buffer, const A& a)
    {
-      throw std::underflow_error(std::string("Missing ")
-                                 + std::to_string(no_of_items)
-                                 + " arguments to pack");
+      static_assert(std::is_constructible<std::string, A>::value
+                       && !std::is_null_pointer<A>::value,
+                    "Expected string type for string format");
+      status st = status();
+      if (!check_scalar(S, a, st))
+      {
+         raise("pack", st, 's');
+      }
+      std::memcpy(buffer + O, data(a), S);
    }
-}
 
-template <typename... T>
-inline std::vector<char> struc::pack(const std::string& pattern,
-                                     const std::tuple<T...>& t)
-{
-   struc s(pattern);
-   size_t no_of_items, align = 1;
-   std::pair<size_t, size_t> pos(0, 1);
-   auto sz = s.calcsize_helper(pos, no_of_items);
-   if (s.c == native)
+   template <control C, size_t O, size_t S>
+   static void unpack(const char* buffer, std::string& s)
    {
-      align = pos.second;
+      s.assign(buffer + O, S);
    }
-   std::vector<char> v(sz, '\0');
-   s.pack(&v[0], t);
-   return v;
-}
 
-template <typename F>
-inline typename std::enable_if<std::is_same<F, float>::value, void>::type
-   struc::unpack_non_ieee(bool little_endian,
-                          const char* buffer,
-                          size_t& offset,
-                          F& f)
-{
-   uint8_t sign;
-   int e;
-   uint32_t bits;
-   if (little_endian)
-   {
-      sign = (static_cast<uint8_t>(buffer[offset + 3]) >> 7) & 0x1;
-      e = static_cast<int>((static_cast<uint8_t>(buffer[offset + 3]) & 0x7f)
-                           << 1);
-      e |= (static_cast<uint8_t>(buffer[offset + 2]) >> 7) & 0x1;
-      bits = (static_cast<uint32_t>(buffer[offset + 2]) & 0x7f) << 16;
-   }
-   else
-   {
-      sign = (static_cast<uint8_t>(buffer[offset]) >> 7) & 0x1;
-      e = static_cast<int>((static_cast<uint8_t>(buffer[offset]) & 0x7f) << 1);
-      e |= (static_cast<uint8_t>(buffer[offset + 1]) >> 7) & 0x1;
-      bits = (static_cast<uint32_t>(buffer[offset + 1]) & 0x7f) << 16;
-   }
-   if (e == 255)
-   {
-      throw std::runtime_error("Can't unpack ieee special value");
-   }
-   if (little_endian)
+   template <control C, size_t O, size_t S>
+   static void unpack(const char* buffer, char* s)
    {
-      bits |= static_cast<uint32_t>(buffer[offset + 1]) << 8;
-      bits |= static_cast<uint32_t>(buffer[offset]);
+      std::memcpy(s, buffer + O, S);
+      s[S] = '\0';
    }
-   else
+
+   static const char* data(const std::string& s)
    {
-      bits |= static_cast<uint32_t>(buffer[offset + 2]) << 8;
-      bits |= static_cast<uint32_t>(buffer[offset + 3]);
+      return s.data();
    }
-   f = static_cast<double>(bits) / 8388608.0;
-   if (e == 0)
+
+   static const char* data(const char* s)
    {
-      e = -126;
+      return s;
    }
-   else
+};
+
+struct struc::pointer_code
+{
+   typedef void* value_type;
+   static constexpr bool valid = true;
+   static constexpr size_t native_size = sizeof(void*);
+   static constexpr size_t standard_size = sizeof(void*);
+   static constexpr size_t alignment = alignof(void*);
+
+   template <control C, size_t O, size_t S, typename P>
+   static void pack(char* buffer, const P& p)
    {
-      f += 1.0;
-      e -= 127;
+      static_assert(std::is_pointer<P>::value || std::is_null_pointer<P>::value,
+                    "Expected pointer type for the P format");
+      const void* p_ = p;
+      std::memcpy(buffer + O, &p_, sizeof(p_));
    }
-   f = std::ldexp(f, e);
-   if (sign)
+
+   template <control C, size_t O, size_t S, typename P>
+   static void unpack(const char* buffer, P& p)
    {
-      f = -f;
+      static_assert(std::is_pointer<P>::value,
+                    "Expected pointer type for the P format");
+      void* p_;
+      std::memcpy(&p_, buffer + O, sizeof(p_));
+      p = static_cast<P>(p_);
    }
-   offset += 4;
-}
+};
+
+struct struc::padding_code
+{
+   static constexpr bool valid = true;
+   static constexpr size_t native_size = 1;
+   static constexpr size_t standard_size = 1;
+   static constexpr size_t alignment = 1;
+};
+
+template <char T, typename D>
+struct struc::code
+{
+   static constexpr bool valid = false;
+   static constexpr size_t native_size = 1;
+   static constexpr size_t standard_size = 1;
+   static constexpr size_t alignment = 1;
+};
+
+template <typename D>
+struct struc::code<'x', D> : padding_code
+{
+};
+
+template <typename D>
+struct struc::code<'c', D> : byte_code<char>
+{
+};
+
+template <typename D>
+struct struc::code<'b', D> : byte_code<signed char>
+{
+};
+
+template <typename D>
+struct struc::code<'B', D> : byte_code<unsigned char>
+{
+};
+
+template <typename D>
+struct struc::code<'?', D> : byte_code<bool>
+{
+};
+
+template <typename D>
+struct struc::code<'h', D> : integer_code<short, int16_t>
+{
+};
+
+template <typename D>
+struct struc::code<'H', D> : integer_code<unsigned short, uint16_t>
+{
+};
+
+template <typename D>
+struct struc::code<'i', D> : integer_code<int, int32_t>
+{
+};
+
+template <typename D>
+struct struc::code<'I', D> : integer_code<unsigned int, uint32_t>
+{
+};
+
+template <typename D>
+struct struc::code<'l', D> : integer_code<long, int32_t>
+{
+};
+
+template <typename D>
+struct struc::code<'L', D> : integer_code<unsigned long, uint32_t>
+{
+};
+
+template <typename D>
+struct struc::code<'q', D> : integer_code<long long, int64_t>
+{
+};
+
+template <typename D>
+struct struc::code<'Q', D> : integer_code<unsigned long long, uint64_t>
+{
+};
+
+template <typename D>
+struct struc::code<'f', D> : float_code<float, uint32_t>
+{
+};
+
+template <typename D>
+struct struc::code<'d', D> : float_code<double, uint64_t>
+{
+};
+
+template <typename D>
+struct struc::code<'s', D> : string_code
+{
+};
+
+template <typename D>
+struct struc::code<'p', D> : string_code
+{
+};
+
+template <typename D>
+struct struc::code<'P', D> : pointer_code
+{
+};
+
+template <char T, size_t O, size_t S, size_t N>
+struct struc::field_items
+{
+   typedef typename run<T, O, S, typename make_indices<N>::type>::type type;
+};
+
+template <size_t O, size_t S, size_t N>
+struct struc::field_items<'x', O, S, N>
+{
+   typedef item_list<> type;
+};
+
+template <size_t O, size_t S, size_t N>
+struct struc::field_items<'s', O, S, N>
+{
+   typedef item_list<item<'s', O, N>> type;
+};
+
+template <size_t O, size_t S, size_t N>
+struct struc::field_items<'p', O, S, N>
+{
+   typedef item_list<item<'p', O, N>> type;
+};
+
+template <typename C,
+          size_t Size,
+          size_t Num,
+          bool Digits,
+          typename Items,
+          char... P>
+struct struc::parser
+{
+   static constexpr control order = C::value;
+   static constexpr size_t size = Size;
+   typedef Items items;
+};
+
+template <typename C,
+          size_t Size,
+          size_t Num,
+          bool Digits,
+          typename Items,
+          char... P>
+struct struc::parser<C, Size, Num, Digits, Items, '\0', P...>
+   : parser<C, Size, Num, Digits, Items>
+{
+};
+
+template <typename C,
+          size_t Size,
+          size_t Num,
+          bool Digits,
+          typename Items,
+          char T,
+          char... P>
+struct struc::parser<C, Size, Num, Digits, Items, T, P...>
+   : std::conditional<
+        T == ' ' || (T >= '\t' && T <= '\r'),
+        parser<C, Size, Num, Digits, Items, P...>,
+        typename std::conditional<
+           T >= '0' && T <= '9',
+           parser<C, Size, Num * 10 + (T - '0'), true, Items, P...>,
+           field_parser<C, Size, Num, Digits, Items, T, P...>>::type>::type
+{
+};
+
+template <typename C,
+          size_t Size,
+          size_t Num,
+          bool Digits,
+          typename Items,
+          char T,
+          char... P>
+struct struc::field_parser
+   : parser<C,
+            Size + (C::value == native ? (code<T>::alignment
+                                          - Size % code<T>::alignment)
+                                            % code<T>::alignment :
+                                         0)
+               + (Digits ? Num : 1) * (C::value == native ?
+                                          code<T>::native_size :
+                                          code<T>::standard_size),
+            0,
+            false,
+            typename concat_items<
+               Items,
+               typename field_items<
+                  T,
+                  Size + (C::value == native ? (code<T>::alignment
+                                                - Size % code<T>::alignment)
+                                                  % code<T>::alignment :
+                                               0),
+                  C::value == native ? code<T>::native_size :
+                                       code<T>::standard_size,
+                  Digits ? Num : 1>::type>::type,
+            P...>
+{
+   static_assert(code<T>::valid, "Encountered illegal type in pattern");
+   static_assert(T != 'P' || C::value == native,
+                 "native byte order is required for the P format");
+};
+
+template <char... P>
+struct struc::pattern_parser
+   : parser<std::integral_constant<control, native>,
+            0,
+            0,
+            false,
+            item_list<>,
+            P...>
+{
+};
 
-template <typename F>
-inline typename std::enable_if<std::is_same<F, double>::value, void>::type
-   struc::unpack_non_ieee(bool litte_endian,
-                          const char* buffer,
-                          size_t& offset,
-                          F& f)
+template <char... P>
+struct struc::pattern_parser<'@', P...>
+   : parser<std::integral_constant<control, native>,
+            0,
+            0,
+            false,
+            item_list<>,
+            P...>
 {
-   uint8_t sign;
-   int e;
-   uint32_t hi;
-   if (litte_endian)
-   {
-      sign = (static_cast<uint8_t>(buffer[offset + 7]) >> 7) & 0x1;
-      e = static_cast<int>((static_cast<uint32_t>(buffer[offset + 7]) & 0x7f)
-                           << 4);
-      e |= (static_cast<uint8_t>(buffer[offset + 6]) >> 4) & 0xf;
-      hi = (static_cast<uint32_t>(buffer[offset + 6]) & 0xf) << 24;
-   }
-   else
-   {
-      sign = (static_cast<uint8_t>(buffer[offset]) >> 7) & 0x1;
-      e = static_cast<int>((static_cast<uint32_t>(buffer[offset]) & 0x7f) << 4);
-      e |= (static_cast<uint8_t>(buffer[offset + 1]) >> 4) & 0xf;
-      hi = (static_cast<uint32_t>(buffer[offset + 1]) & 0xf) << 24;
-   }
-   if (e == 2047)
-   {
-      throw std::runtime_error("Can't unpack ieee special value");
-   }
-   uint32_t lo;
-   if (litte_endian)
-   {
-      hi |= static_cast<uint32_t>(buffer[offset + 5]) << 16;
-      hi |= static_cast<uint32_t>(buffer[offset + 4]) << 8;
-      hi |= static_cast<uint32_t>(buffer[offset + 3]);
-      lo = static_cast<uint32_t>(buffer[offset + 2]) << 16;
-      lo |= static_cast<uint32_t>(buffer[offset + 1]) << 8;
-      lo |= static_cast<uint32_t>(buffer[offset]);
-   }
-   else
-   {
-      hi |= static_cast<uint32_t>(buffer[offset + 2]) << 16;
-      hi |= static_cast<uint32_t>(buffer[offset + 3]) << 8;
-      hi |= static_cast<uint32_t>(buffer[offset + 4]);
-      lo = static_cast<uint32_t>(buffer[offset + 5]) << 16;
-      lo |= static_cast<uint32_t>(buffer[offset + 6]) << 8;
-      lo |= static_cast<uint32_t>(buffer[offset + 7]);
-   }
-   f = static_cast<double>(hi) + static_cast<double>(lo) / 16777216.0;
-   f /= 268435456.0;
-   if (e == 0)
-   {
-      e = -1022;
-   }
-   else
-   {
-      f += 1.0;
-      e -= 1023;
-   }
-   f = std::ldexp(f, e);
-   if (sign)
-   {
-      f = -f;
-   }
-   offset += 8;
-}
+};
 
-template <typename F>
-inline typename std::enable_if<!std::is_same<F, float>::value
-                                  && !std::is_same<F, double>::value,
-                               void>::type
-   struc::unpack_non_ieee(bool, const char*, size_t&, F&)
+template <char... P>
+struct struc::pattern_parser<'=', P...>
+   : parser<std::integral_constant<control, standard>,
+            0,
+            0,
+            false,
+            item_list<>,
+            P...>
 {
-   throw std::runtime_error(
-      "Internal error: Only float or double allowed for ieee unpacking");
-}
+};
 
-template <typename I, typename T, typename U>
-inline typename std::enable_if<std::is_integral<T>::value, void>::type
-   struc::unpack_native(const char* buffer, size_t& offset, I& i)
+template <char... P>
+struct struc::pattern_parser<'<', P...>
+   : parser<std::integral_constant<control, litte_endian>,
+            0,
+            0,
+            false,
+            item_list<>,
+            P...>
 {
-   T i_;
-   size_t pad = padding<T>(offset);
-   if (pad > 0)
-   {
-      offset += pad;
-   }
-   std::memcpy(&i_, buffer + offset, sizeof(i_));
-   i = static_cast<I>(i_);
-   offset += sizeof(i_);
-}
+};
 
-template <typename F, typename T, typename U>
-inline typename std::enable_if<std::is_floating_point<T>::value, void>::type
-   struc::unpack_native(const char* buffer, size_t& offset, F& f)
+template <char... P>
+struct struc::pattern_parser<'>', P...>
+   : parser<std::integral_constant<control, big_endian>,
+            0,
+            0,
+            false,
+            item_list<>,
+            P...>
 {
-   T f_;
-   size_t pad = padding<T>(offset);
-   if (pad > 0)
-   {
-      offset += pad;
-   }
-   if (is_ieee<T>())
-   {
-      std::memcpy(&f_, buffer + offset, sizeof(f_));
-      f = static_cast<F>(f_);
-      offset += sizeof(f_);
-   }
-   else
+};
+
+template <char... P>
+struct struc::pattern_parser<'!', P...>
+   : parser<std::integral_constant<control, big_endian>,
+            0,
+            0,
+            false,
+            item_list<>,
+            P...>
+{
+};
+
+//! @brief Pattern parsed at compile time
+//!
+//! Offsets, sizes and argument types are resolved by the compiler, so pack
+//! and unpack compile down to straight-line code without any checks at run
+//! time besides the length of strings.
+template <char... P>
+class struc::fixed
+{
+public:
+   //! @brief Like python's struct.pack
+   //! @{
+   template <typename... T>
+   static void pack(char* buffer, const T&... t);
+   template <typename... T>
+   static void pack(char* buffer, const std::tuple<T...>& t);
+   //! @}
+
+   //! @brief Like python's struct.unpack
+   //! @{
+   template <typename... T>
+   static void unpack(const char* buffer, T&... t);
+   template <typename... T>
+   static void unpack(const char* buffer, std::tuple<T...>& t);
+   //! @}
+
+   //! @brief Pack or unpack item I in place
+   //! @{
+   template <size_t I, typename T>
+   static void pack_field(char* buffer, const T& t);
+   template <size_t I, typename T>
+   static void unpack_field(const char* buffer, T& t);
+   //! @}
+
+   //! @brief Like python's struct.calcsize
+   static constexpr size_t calcsize();
+
+   //! @brief Distance between back-to-back records, see struc::stride
+   static constexpr size_t stride();
+
+   //! @brief Read only access to single items of a packed buffer
+   class view;
+
+   //! @brief Like python's struct.iter_unpack, see struc::iter_unpack
+   static records<view> iter_unpack(const char* buffer, size_t length);
+
+private:
+   typedef pattern_parser<P...> parsed;
+
+   template <typename... I>
+   static constexpr size_t alignment(item_list<I...>);
+
+   template <typename L>
+   struct item_tuple;
+
+   template <typename... I>
+   struct item_tuple<item_list<I...>>
    {
-#ifdef BOOST_BIG_ENDIAN
-      unpack_non_ieee<T>(false, buffer, offset, f_);
-#else
-      unpack_non_ieee<T>(true, buffer, offset, f_);
-#endif
-      f = static_cast<F>(f_);
-   }
-}
+      typedef std::tuple<I...> type;
+   };
 
-template <typename I, typename T, typename U>
-inline typename std::enable_if<std::is_integral<T>::value, void>::type
-   struc::unpack_non_native(control c, const char* buffer, size_t& offset, I& i)
+   template <size_t I>
+   using item_at = typename std::tuple_element<
+      I,
+      typename item_tuple<typename parsed::items>::type>::type;
+
+   template <typename... I, typename... T>
+   static void pack_items(item_list<I...>, char* buffer, const T&... t);
+
+   template <typename... I, typename... T>
+   static void unpack_items(item_list<I...>, const char* buffer, T&... t);
+
+   template <size_t... I, typename... T>
+   static void pack_tuple(indices<I...>,
+                          char* buffer,
+                          const std::tuple<T...>& t);
+
+   template <size_t... I, typename... T>
+   static void unpack_tuple(indices<I...>,
+                            const char* buffer,
+                            std::tuple<T...>& t);
+};
+
+//! @brief Read only access to single items of a packed buffer
+template <char... P>
+class struc::fixed<P...>::view
 {
-   T i_;
-   std::memcpy(&i_, buffer + offset, sizeof(i_));
-   from_endian(c, i_);
-   i = static_cast<I>(i_);
-   offset += sizeof(i_);
+public:
+   //! @brief Constructor
+   explicit view(const char* buffer);
+
+   //! @brief Decode item I
+   template <size_t I>
+   typename item_at<I>::value_type get() const;
+
+   //! @brief Unpack the whole record
+   //! @{
+   template <typename... T>
+   void unpack(T&... t) const;
+   template <typename... T>
+   void unpack(std::tuple<T...>& t) const;
+   //! @}
+
+   //! @brief Packed bytes of item I
+   template <size_t I>
+   const char* data() const;
+
+   //! @brief The packed buffer
+   const char* data() const;
+
+private:
+   template <typename V>
+   friend class records;
+
+   const char* buffer;
+};
+
+template <char... P>
+template <typename... T>
+inline void struc::fixed<P...>::pack(char* buffer, const T&... t)
+{
+   pack_items(typename parsed::items(), buffer, t...);
 }
 
-template <typename F, typename T, typename U>
-inline typename std::enable_if<std::is_floating_point<T>::value, void>::type
-   struc::unpack_non_native(control c, const char* buffer, size_t& offset, F& f)
+template <char... P>
+template <typename... T>
+inline void struc::fixed<P...>::pack(char* buffer, const std::tuple<T...>& t)
 {
-   static_assert(sizeof(T) == sizeof(U), "Size of T and U must be equal");
-   T f_;
-   if (is_ieee<T>())
-   {
-      U* i = reinterpret_cast<U*>(&f_);
-      std::memcpy(&f_, buffer + offset, sizeof(f_));
-      from_endian(c, *i);
-      f = static_cast<F>(f_);
-      offset += sizeof(f_);
-   }
-   else
-   {
-      unpack_non_ieee<T>(c == litte_endian, buffer, offset, f_);
-      f = static_cast<F>(f_);
-   }
+   pack_tuple(typename make_indices<sizeof...(T)>::type(), buffer, t);
 }
 
-template <typename I>
-inline typename std::enable_if<std::is_arithmetic<I>::value, void>::type
-   struc::unpack_scalar(control c,
-                        std::pair<size_t, char>& cur,
-                        const char* buffer,
-                        size_t& offset,
-                        I& i)
+template <char... P>
+template <typename... T>
+inline void struc::fixed<P...>::unpack(const char* buffer, T&... t)
 {
-   switch (cur.second)
-   {
-   case 'c':
-   case 'b':
-   case 'B':
-   case '?':
-      std::memcpy(&i, buffer + offset, 1);
-      offset += 1;
-      break;
-   case 'h':
-      c == native ? unpack_native<I, short>(buffer, offset, i) :
-                    unpack_non_native<I, int16_t>(c, buffer, offset, i);
-      break;
-   case 'H':
-      c == native ? unpack_native<I, unsigned short>(buffer, offset, i) :
-                    unpack_non_native<I, uint16_t>(c, buffer, offset, i);
-      break;
-   case 'i':
-      c == native ? unpack_native<I, int>(buffer, offset, i) :
-                    unpack_non_native<I, int32_t>(c, buffer, offset, i);
-      break;
-   case 'I':
-      c == native ? unpack_native<I, unsigned int>(buffer, offset, i) :
-                    unpack_non_native<I, uint32_t>(c, buffer, offset, i);
-      break;
-   case 'l':
-      c == native ? unpack_native<I, long>(buffer, offset, i) :
-                    unpack_non_native<I, int32_t>(c, buffer, offset, i);
-      break;
-   case 'L':
-      c == native ? unpack_native<I, unsigned long>(buffer, offset, i) :
-                    unpack_non_native<I, uint32_t>(c, buffer, offset, i);
-      break;
-   case 'q':
-      c == native ? unpack_native<I, long long>(buffer, offset, i) :
-                    unpack_non_native<I, int64_t>(c, buffer, offset, i);
-      break;
-   case 'Q':
-      c == native ? unpack_native<I, unsigned long long>(buffer, offset, i) :
-                    unpack_non_native<I, uint64_t>(c, buffer, offset, i);
-      break;
-   case 'f':
-      c == native ? unpack_native<I, float>(buffer, offset, i) :
-                    unpack_non_native<I, float, uint32_t>(c, buffer, offset, i);
-      break;
-   case 'd':
-      c == native ?
-         unpack_native<I, double>(buffer, offset, i) :
-         unpack_non_native<I, double, uint64_t>(c, buffer, offset, i);
-      break;
-   default:
-      throw std::logic_error(std::string("Encountered illegal type: ")
-                             + cur.second);
-   }
-   cur.first--;
+   unpack_items(typename parsed::items(), buffer, t...);
 }
 
-template <typename A>
-inline
-   typename std::enable_if<std::is_array<A>::value
-                              && !std::is_constructible<std::string, A>::value,
-                           void>::type
-   struc::unpack_scalar(control c,
-                        std::pair<size_t, char>& cur,
-                        const char* buffer,
-                        size_t& offset,
-                        A& a)
+template <char... P>
+template <typename... T>
+inline void struc::fixed<P...>::unpack(const char* buffer,
+                                       std::tuple<T...>& t)
 {
-   if (std::extent<A>::value < cur.first)
-   {
-      throw std::underflow_error(std::string("Provided array too small (")
-                                 + std::to_string(std::extent<A>::value)
-                                 + "), expected "
-                                 + std::to_string(cur.first));
-   }
-   else if (std::extent<A>::value > cur.first)
-   {
-      throw std::overflow_error(std::string("Provided array too large (")
-                                + std::to_string(std::extent<A>::value)
-                                + "), expected "
-                                + std::to_string(cur.first));
-   }
-   for (size_t i = 0; i < std::extent<A>::value; ++i)
-   {
-      unpack_scalar(c, cur, buffer, offset, a[i]);
-   }
+   unpack_tuple(typename make_indices<sizeof...(T)>::type(), buffer, t);
 }
 
-template <typename S>
-inline typename std::enable_if<std::is_same<std::string, S>::value, void>::type
-   struc::unpack_scalar(control,
-                        std::pair<size_t, char>& cur,
-                        const char* buffer,
-                        size_t& offset,
-                        S& s)
+template <char... P>
+template <size_t I, typename T>
+inline void struc::fixed<P...>::pack_field(char* buffer, const T& t)
 {
-   switch (cur.second)
-   {
-   case 's':
-   case 'p':
-   {
-      size_t sz = s.size();
-      s = std::string(buffer + offset, sz);
-      offset += sz;
-      cur.first--;
-      break;
-   }
-   default:
-      throw std::logic_error(std::string("Encountered illegal type: ")
-                             + cur.second);
-   }
+   item_at<I>::template pack<parsed::order>(buffer, t);
 }
 
-template <typename S>
-inline typename std::enable_if<std::is_constructible<std::string, S>::value
-                                  && !std::is_null_pointer<S>::value
-                                  && !std::is_same<std::string, S>::value,
-                               void>::type
-   struc::unpack_scalar(control c,
-                        std::pair<size_t, char>& cur,
-                        const char* buffer,
-                        size_t& offset,
-                        S& s)
+template <char... P>
+template <size_t I, typename T>
+inline void struc::fixed<P...>::unpack_field(const char* buffer, T& t)
 {
-   switch (cur.second)
-   {
-   case 's':
-   case 'p':
-   {
-      size_t sz = strlen(s);
-      std::memcpy(s, buffer + offset, sz);
-      offset += sz;
-      cur.first--;
-      break;
-   }
-   case 'c':
-   {
-      if (!std::is_array<S>::value)
-      {
-         throw std::logic_error("Expected array of char");
-      }
-      if (std::extent<S>::value < cur.first)
-      {
-         throw std::underflow_error(std::string("Provided array too small (")
-                                    + std::to_string(std::extent<S>::value)
-                                    + "), expected "
-                                    + std::to_string(cur.first));
-      }
-      else if (std::extent<S>::value > cur.first)
-      {
-         throw std::overflow_error(std::string("Provided array too large (")
-                                   + std::to_string(std::extent<S>::value)
-                                   + "), expected "
-                                   + std::to_string(cur.first));
-      }
-      for (size_t i = 0; i < std::extent<S>::value; ++i)
-      {
-         unpack_scalar(c, cur, buffer, offset, s[i]);
-      }
-      break;
-   }
-   default:
-      throw std::logic_error(std::string("Encountered illegal type: ")
-                             + cur.second);
-   }
+   item_at<I>::template unpack<parsed::order>(buffer, t);
 }
 
-template <typename P>
-inline
-   typename std::enable_if<(std::is_pointer<P>::value
-                            && !std::is_constructible<std::string, P>::value)
-                              || std::is_member_pointer<P>::value,
-                           void>::type
-   struc::unpack_scalar(control c,
-                        std::pair<size_t, char>& cur,
-                        const char* buffer,
-                        size_t& offset,
-                        P& p)
+template <char... P>
+inline constexpr size_t struc::fixed<P...>::calcsize()
 {
-   if (cur.second == 'P')
-   {
-      if (c == native)
-      {
-         void* p_;
-         size_t pad = padding<void*>(offset);
-         if (pad > 0)
-         {
-            offset += pad;
-         }
-         std::memcpy(&p_, buffer + offset, sizeof(p_));
-         p = static_cast<P>(p_);
-         offset += sizeof(p_);
-         cur.first--;
-      }
-      else
-      {
-         throw std::logic_error(
-            std::string("native byte order is required for the P format"));
-      }
-   }
-   else
-   {
-      throw std::logic_error(std::string("Encountered illegal type: ")
-                             + cur.second);
-   }
+   return parsed::size;
 }
 
-template <typename T>
-inline size_t struc::unpack_helper(std::pair<size_t, size_t>& pos,
-                                   std::pair<size_t, char>& cur,
-                                   const char*& buffer,
-                                   size_t& offset,
-                                   T& t) const
+template <char... P>
+inline constexpr size_t struc::fixed<P...>::stride()
 {
-   if (cur.first > 0)
-   {
-      unpack_scalar(c, cur, buffer, offset, t);
-      auto alignment = c == native ? native_alignment(cur.second) : 0;
-      pos.second = std::max(pos.second, alignment);
-      return 1;
-   }
-   cur.first = 1;
-   std::ostringstream ss;
-   while (pos.first < pattern.size())
-   {
-      cur.second = pattern[pos.first++];
-      if (std::isspace(cur.second))
-      {
-         continue;
-      }
-      if (std::isdigit(cur.second))
-      {
-         ss << cur.second;
-         continue;
-      }
-      auto n = ss.str();
-      ss.clear();
-      ss.str("");
-      if (n.size() > 0)
-      {
-         try
-         {
-            cur.first = std::stoul(n);
-         }
-         catch (...)
-         {
-            cur.first = 1;
-         }
-      }
-      if (cur.second == 'x')
-      {
-         offset += cur.first;
-         cur.first = 1;
-         continue;
-      }
-      else if (cur.second == 's' || cur.second == 'p')
-      {
-         prep_scalar(cur.first, t);
-         cur.first = 1;
-      }
-      if (cur.first > 0)
-      {
-         unpack_scalar(c, cur, buffer, offset, t);
-         auto alignment = c == native ? native_alignment(cur.second) : 0;
-         pos.second = std::max(pos.second, alignment);
-      }
-      else if (c == native)
-      {
-         offset += native_padding(offset, cur.second);
-         pos.second = std::max(pos.second, native_alignment(cur.second));
-         continue;
-      }
-      return 1;
-   }
-   return 0;
+   return parsed::order == native ?
+      (parsed::size + alignment(typename parsed::items()) - 1)
+         / alignment(typename parsed::items())
+         * alignment(typename parsed::items()) :
+      parsed::size;
 }
 
-template <typename T, typename... Ts>
-inline size_t struc::unpack_helper(std::pair<size_t, size_t>& pos,
-                                   std::pair<size_t, char>& cur,
-                                   const char*& buffer,
-                                   size_t& offset,
-                                   T& t,
-                                   Ts&... ts) const
+template <char... P>
+inline struc::records<typename struc::fixed<P...>::view>
+   struc::fixed<P...>::iter_unpack(const char* buffer, size_t length)
 {
-   auto sz = unpack_helper(pos, cur, buffer, offset, t);
-   sz += unpack_helper(pos, cur, buffer, offset, ts...);
-   return sz;
+   return records<view>(
+      view(buffer),
+      stride(),
+      record_count("iter_unpack", length, calcsize(), stride()));
 }
 
-template <typename... T>
-inline void struc::unpack(const char* buffer, T&... t) const
+template <char... P>
+template <typename... I>
+inline constexpr size_t struc::fixed<P...>::alignment(item_list<I...>)
 {
-   size_t no_of_items, offset = 0;
-   std::pair<size_t, size_t> pos(0, 1);
-   std::pair<size_t, char> cur(0, 'x');
-   auto unpacked_items = unpack_helper(pos, cur, buffer, offset, t...);
-   if (unpacked_items < sizeof...(T))
-   {
-      throw std::overflow_error(std::string("Extra ")
-                                + std::to_string(sizeof...(T)-unpacked_items)
-                                + " arguments to unpack");
-   }
-   calcsize_helper(pos, no_of_items);
-   no_of_items += cur.first;
-   if (no_of_items > 0)
-   {
-      throw std::underflow_error(std::string("Missing ")
-                                 + std::to_string(no_of_items)
-                                 + " arguments to unpack");
-   }
+   return max_of(1, I::alignment...);
 }
 
-template <typename... T>
-inline void struc::unpack(const std::string& pattern,
-                          const char* buffer,
-                          T&... t)
+template <char... P>
+template <typename... I, typename... T>
+inline void struc::fixed<P...>::pack_items(item_list<I...>,
+                                           char* buffer,
+                                           const T&... t)
 {
-   struc s(pattern);
-   s.unpack(buffer, t...);
+   static_assert(sizeof...(I) == sizeof...(T),
+                 "Wrong number of arguments to pack");
+   int expand[] = {0, (I::template pack<parsed::order>(buffer, t), 0)...};
+   (void)expand;
+   (void)buffer;
 }
 
-template <size_t I, typename... T>
-inline typename std::enable_if<I == sizeof...(T), size_t>::type
-   struc::unpack_helper_t(std::pair<size_t, size_t>&,
-                          std::pair<size_t, char>&,
-                          const char*&,
-                          size_t&,
-                          std::tuple<T...>&) const
+template <char... P>
+template <typename... I, typename... T>
+inline void struc::fixed<P...>::unpack_items(item_list<I...>,
+                                             const char* buffer,
+                                             T&... t)
 {
-   return 0;
+   static_assert(sizeof...(I) == sizeof...(T),
+                 "Wrong number of arguments to unpack");
+   int expand[] = {0, (I::template unpack<parsed::order>(buffer, t), 0)...};
+   (void)expand;
+   (void)buffer;
 }
 
-template <size_t I, typename... T>
-   inline typename std::enable_if
-   < I<sizeof...(T), size_t>::type struc::unpack_helper_t(
-        std::pair<size_t, size_t>& pos,
-        std::pair<size_t, char>& cur,
-        const char*& buffer,
-        size_t& offset,
-        std::tuple<T...>& t) const
+template <char... P>
+template <size_t... I, typename... T>
+inline void struc::fixed<P...>::pack_tuple(indices<I...>,
+                                           char* buffer,
+                                           const std::tuple<T...>& t)
 {
-   auto sz = unpack_helper(pos, cur, buffer, offset, std::get<I>(t));
-   sz += unpack_helper_t<I + 1, T...>(pos, cur, buffer, offset, t);
-   return sz;
+   pack(buffer, std::get<I>(t)...);
 }
 
-template <typename... T>
-inline void struc::unpack(const char* buffer, std::tuple<T...>& t) const
+template <char... P>
+template <size_t... I, typename... T>
+inline void struc::fixed<P...>::unpack_tuple(indices<I...>,
+                                             const char* buffer,
+                                             std::tuple<T...>& t)
 {
-   size_t no_of_items, offset = 0;
-   std::pair<size_t, size_t> pos(0, 1);
-   std::pair<size_t, char> cur(0, 'x');
-   auto unpacked_items = unpack_helper_t(pos, cur, buffer, offset, t);
-   if (unpacked_items < sizeof...(T))
-   {
-      throw std::overflow_error(std::string("Extra ")
-                                + std::to_string(sizeof...(T)-unpacked_items)
-                                + " arguments to unpack");
-   }
-   calcsize_helper(pos, no_of_items);
-   no_of_items += cur.first;
-   if (no_of_items > 0)
-   {
-      throw std::underflow_error(std::string("Missing ")
-                                 + std::to_string(no_of_items)
-                                 + " arguments to unpack");
-   }
+   unpack(buffer, std::get<I>(t)...);
 }
 
-template <typename... T>
-inline void struc::unpack(const std::string& pattern,
-                          const char* buffer,
-                          std::tuple<T...>& t)
+template <char... P>
+inline struc::fixed<P...>::view::view(const char* buffer_)
+: buffer(buffer_)
 {
-   struc s(pattern);
-   s.unpack(buffer, t);
 }
 
-inline struc::struc(const std::string& pattern_)
-: pattern(pattern_)
-, c(native)
+template <char... P>
+template <size_t I>
+inline typename struc::fixed<P...>::template item_at<I>::value_type
+   struc::fixed<P...>::view::get() const
 {
-   if (pattern.find_first_of("@=<>!") == 0)
-   {
-      switch (pattern[0])
-      {
-      case '@':
-         c = native;
-         break;
-      case '=':
-         c = standard;
-         break;
-      case '<':
-         c = litte_endian;
-         break;
-      case '>':
-      case '!':
-         c = big_endian;
-         break;
-      default:
-         break;
-      }
-      pattern.erase(0, 1);
-   }
+   typename item_at<I>::value_type v;
+   item_at<I>::template unpack<parsed::order>(buffer, v);
+   return v;
 }
 
-inline size_t struc::calcsize_helper(std::pair<size_t, size_t>& pos,
-                                     size_t& no_of_items) const
+template <char... P>
+template <size_t I>
+inline const char* struc::fixed<P...>::view::data() const
 {
-   size_t size = 0;
-   no_of_items = 0;
-   std::ostringstream ss;
-   while (pos.first < pattern.size())
-   {
-      char type = pattern[pos.first++];
-      if (std::isspace(type))
-      {
-         continue;
-      }
-      if (std::isdigit(type))
-      {
-         ss << type;
-         continue;
-      }
-      auto n = ss.str();
-      ss.clear();
-      ss.str("");
-      size_t num = 1;
-      if (n.size() > 0)
-      {
-         try
-         {
-            num = std::stoul(n);
-         }
-         catch (...)
-         {
-            num = 1;
-         }
-      }
-      size_t sz;
-      size_t pad = c == native ? native_padding(size, type) : 0;
-      switch (type)
-      {
-      case 'h':
-         sz = c == native ? sizeof(short) : sizeof(int16_t);
-         break;
-      case 'H':
-         sz = c == native ? sizeof(unsigned short) : sizeof(int16_t);
-         break;
-      case 'i':
-         sz = c == native ? sizeof(int) : sizeof(int32_t);
-         break;
-      case 'I':
-         sz = c == native ? sizeof(unsigned int) : sizeof(int32_t);
-         break;
-      case 'l':
-         sz = c == native ? sizeof(long) : sizeof(int32_t);
-         break;
-      case 'L':
-         sz = c == native ? sizeof(unsigned long) : sizeof(int32_t);
-         break;
-      case 'q':
-         sz = c == native ? sizeof(long long) : sizeof(int64_t);
-         break;
-      case 'Q':
-         sz = c == native ? sizeof(unsigned long long) : sizeof(int64_t);
-         break;
-      case 'f':
-         sz = c == native ? sizeof(float) : sizeof(float);
-         break;
-      case 'd':
-         sz = c == native ? sizeof(double) : sizeof(double);
-         break;
-      case 'P':
-         if (c != native)
-         {
-            throw std::logic_error(
-               std::string("native byte order is required for the P format"));
-         }
-         sz = sizeof(void*);
-         break;
-      case 'x':
-      case 'c':
-      case 'b':
-      case 'B':
-      case '?':
-         sz = 1;
-         break;
-      case 's':
-      case 'p':
-         sz = num;
-         num = 1;
-         break;
-      default:
-         throw std::logic_error(std::string("Encountered illegal type: ")
-                                + type);
-      }
-      size += pad + sz * num;
-      if (type != 'x')
-      {
-         no_of_items += num;
-      }
-      auto alignment = c == native ? native_alignment(type) : 0;
-      pos.second = std::max(pos.second, alignment);
-   }
-   return size;
+   return buffer + item_at<I>::offset;
 }
 
-inline size_t struc::calcsize() const
+template <char... P>
+inline const char* struc::fixed<P...>::view::data() const
 {
-   size_t no_of_items;
-   std::pair<size_t, size_t> pos(0, 1);
-   return calcsize_helper(pos, no_of_items);
+   return buffer;
 }
 
-inline size_t struc::calcsize(const std::string& pattern)
+template <char... P>
+template <typename... T>
+inline void struc::fixed<P...>::view::unpack(T&... t) const
+{
+   fixed::unpack(buffer, t...);
+}
+
+template <char... P>
+template <typename... T>
+inline void struc::fixed<P...>::view::unpack(std::tuple<T...>& t) const
 {
-   struc s(pattern);
-   return s.calcsize();
+   fixed::unpack(buffer, t);
 }
+
+//! @brief struc::fixed for a pattern literal of at most 64 characters
+#define STRUC_FIXED(pattern)                                                   \
+   struc::fixed<struc::pattern_at(pattern, 0),                                 \
+                struc::pattern_at(pattern, 1),                                 \
+                struc::pattern_at(pattern, 2),                                 \
+                struc::pattern_at(pattern, 3),                                 \
+                struc::pattern_at(pattern, 4),                                 \
+                struc::pattern_at(pattern, 5),                                 \
+                struc::pattern_at(pattern, 6),                                 \
+                struc::pattern_at(pattern, 7),                                 \
+                struc::pattern_at(pattern, 8),                                 \
+                struc::pattern_at(pattern, 9),                                 \
+                struc::pattern_at(pattern, 10),                                \
+                struc::pattern_at(pattern, 11),                                \
+                struc::pattern_at(pattern, 12),                                \
+                struc::pattern_at(pattern, 13),                                \
+                struc::pattern_at(pattern, 14),                                \
+                struc::pattern_at(pattern, 15),                                \
+                struc::pattern_at(pattern, 16),                                \
+                struc::pattern_at(pattern, 17),                                \
+                struc::pattern_at(pattern, 18),                                \
+                struc::pattern_at(pattern, 19),                                \
+                struc::pattern_at(pattern, 20),                                \
+                struc::pattern_at(pattern, 21),                                \
+                struc::pattern_at(pattern, 22),                                \
+                struc::pattern_at(pattern, 23),                                \
+                struc::pattern_at(pattern, 24),                                \
+                struc::pattern_at(pattern, 25),                                \
+                struc::pattern_at(pattern, 26),                                \
+                struc::pattern_at(pattern, 27),                                \
+                struc::pattern_at(pattern, 28),                                \
+                struc::pattern_at(pattern, 29),                                \
+                struc::pattern_at(pattern, 30),                                \
+                struc::pattern_at(pattern, 31),                                \
+                struc::pattern_at(pattern, 32),                                \
+                struc::pattern_at(pattern, 33),                                \
+                struc::pattern_at(pattern, 34),                                \
+                struc::pattern_at(pattern, 35),                                \
+                struc::pattern_at(pattern, 36),                                \
+                struc::pattern_at(pattern, 37),                                \
+                struc::pattern_at(pattern, 38),                                \
+                struc::pattern_at(pattern, 39),                                \
+                struc::pattern_at(pattern, 40),                                \
+                struc::pattern_at(pattern, 41),                                \
+                struc::pattern_at(pattern, 42),                                \
+                struc::pattern_at(pattern, 43),                                \
+                struc::pattern_at(pattern, 44),                                \
+                struc::pattern_at(pattern, 45),                                \
+                struc::pattern_at(pattern, 46),                                \
+                struc::pattern_at(pattern, 47),                                \
+                struc::pattern_at(pattern, 48),                                \
+                struc::pattern_at(pattern, 49),                                \
+                struc::pattern_at(pattern, 50),                                \
+                struc::pattern_at(pattern, 51),                                \
+                struc::pattern_at(pattern, 52),                                \
+                struc::pattern_at(pattern, 53),                                \
+                struc::pattern_at(pattern, 54),                                \
+                struc::pattern_at(pattern, 55),                                \
+                struc::pattern_at(pattern, 56),                                \
+                struc::pattern_at(pattern, 57),                                \
+                struc::pattern_at(pattern, 58),                                \
+                struc::pattern_at(pattern, 59),                                \
+                struc::pattern_at(pattern, 60),                                \
+                struc::pattern_at(pattern, 61),                                \
+                struc::pattern_at(pattern, 62),                                \
+                struc::pattern_at(pattern, 63),                                \
+                struc::pattern_at(pattern, 64)>
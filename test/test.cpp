@@ -17,7 +17,19 @@
     Copyright (c) 2018, emJay Software Consulting AB, See AUTHORS for details.
 */
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
 #include "struc.hpp"
 
 #define CATCH_CONFIG_MAIN
@@ -39,7 +51,7 @@ template <typename T>
 typename std::enable_if<std::is_same<T, std::string>::value, std::string>::type
    py_arg(const T& t)
 {
-   return std::string("'" + t + "'");
+   return std::string("b'" + t + "'");
 }
 
 template <typename T>
@@ -58,7 +70,7 @@ std::string py_arg<bool>(const bool& t)
 template <>
 std::string py_arg<char>(const char& t)
 {
-   return std::string("'") + t + "'";
+   return std::string("b'") + t + "'";
 }
 
 template <typename T>
@@ -96,8 +108,8 @@ std::string python_struct_pack(const std::string& pattern,
                                const std::tuple<T...>& t)
 {
    std::ostringstream ss;
-   ss << "import struct; print(struct.pack('" << pattern << "', " << py_arg_t(t)
-      << ").encode('hex'))";
+   ss << "import binascii, struct; print(binascii.hexlify(struct.pack('"
+      << pattern << "', " << py_arg_t(t) << ")).decode())";
    return ss.str();
 }
 
@@ -553,3 +565,1207 @@ TEST_CASE("Illegal pattern throw exception", "[struc]")
    pattern = "@P";
    CHECK_NOTHROW(struc::calcsize(pattern));
 }
+
+TEST_CASE("Reused struc object", "[struc]")
+{
+   struc s("<hx2I3s");
+   REQUIRE(s.calcsize() == 2 + 1 + 8 + 3);
+   std::vector<char> v(s.calcsize());
+   for (int n = 0; n < 3; ++n)
+   {
+      unsigned int arr[2] = {static_cast<unsigned int>(n), 7};
+      s.pack(v.data(), static_cast<short>(-n), arr, std::string("abc"));
+      short h;
+      unsigned int arr_[2];
+      std::string str;
+      s.unpack(v.data(), h, arr_, str);
+      CHECK(h == -n);
+      CHECK(arr_[0] == static_cast<unsigned int>(n));
+      CHECK(arr_[1] == 7);
+      CHECK(str == "abc");
+   }
+}
+
+TEST_CASE("Compile-time patterns", "[struc]")
+{
+   typedef STRUC_FIXED("<hH2iq5sd") F;
+   static_assert(F::calcsize() == 33, "Wrong compile-time size");
+   std::array<char, F::calcsize()> buf;
+   F::pack(buf.data(), -1, 2, 3, -4, 5LL, "hello", 1.5);
+   auto v = struc::pack(std::string("<hH2iq5sd"),
+                        -1,
+                        2,
+                        3,
+                        -4,
+                        5LL,
+                        "hello",
+                        1.5);
+   REQUIRE(v.size() == buf.size());
+   CHECK(std::equal(v.begin(), v.end(), buf.begin()));
+   short h;
+   unsigned short H;
+   int i1, i2;
+   long long q;
+   std::string s;
+   double d;
+   F::unpack(buf.data(), h, H, i1, i2, q, s, d);
+   CHECK(h == -1);
+   CHECK(H == 2);
+   CHECK(i1 == 3);
+   CHECK(i2 == -4);
+   CHECK(q == 5);
+   CHECK(s == "hello");
+   CHECK(d == 1.5);
+
+   typedef std::tuple<bool, short, char, double, void*> T;
+   typedef struc::fixed<'?', 'h', 'c', 'd', 'P'> G;
+   REQUIRE(G::calcsize() == struc::calcsize("?hcdP"));
+   T t1(true, -7, 'x', 2.5, nullptr);
+   std::array<char, G::calcsize()> buf2 = {};
+   G::pack(buf2.data(), t1);
+   v = struc::pack(std::string("?hcdP"), t1);
+   CHECK(std::equal(v.begin(), v.end(), buf2.begin()));
+   T t2;
+   G::unpack(buf2.data(), t2);
+   CHECK(t1 == t2);
+}
+
+TEST_CASE("Pattern cache", "[struc]")
+{
+   struc::cache::clear();
+   auto s1 = struc::cache::get("<2hI");
+   auto s2 = struc::cache::get("<2hI");
+   CHECK(s1 == s2);
+   CHECK(s1->calcsize() == 8);
+   CHECK(struc::cache::size() == 1);
+   auto capacity = struc::cache::capacity();
+   struc::cache::capacity(2);
+   struc::cache::get(">i");
+   struc::cache::get(">q");
+   struc::cache::get(">h");
+   CHECK(struc::cache::size() == 2);
+   CHECK_THROWS_AS(struc::cache::get("<P"), std::logic_error);
+   struc::cache::capacity(0);
+   CHECK(struc::cache::get("<2hI") != struc::cache::get("<2hI"));
+   CHECK(struc::cache::size() == 0);
+   struc::cache::capacity(capacity);
+   std::vector<std::thread> threads;
+   std::atomic<int> failures(0);
+   for (int n = 0; n < 4; ++n)
+   {
+      threads.emplace_back([&failures, n]() {
+         for (int i = 0; i < 1000; ++i)
+         {
+            auto v = struc::pack(std::string(i % 2 ? "<hi" : ">hi"), n, i);
+            short h;
+            int l;
+            struc::unpack(i % 2 ? "<hi" : ">hi", v.data(), h, l);
+            if (h != n || l != i)
+            {
+               failures++;
+            }
+         }
+      });
+   }
+   for (auto& t : threads)
+   {
+      t.join();
+   }
+   CHECK(failures == 0);
+   auto s3 = struc::cache::get("<2hI");
+   struc::cache::clear();
+   CHECK(struc::cache::size() == 0);
+   CHECK(struc::cache::get("<2hI") != s3);
+   // compiled patterns outlive eviction
+   CHECK(s1->calcsize() == 8);
+}
+
+TEST_CASE("Record views", "[struc]")
+{
+   std::string pattern("<h3I10sd?");
+   struc s(pattern);
+   auto v = struc::pack(
+      pattern, -5, 1, 2, 3, std::string("0123456789"), 2.5, true);
+   struc::view view(s, v.data());
+   CHECK(view.get<short>(0) == -5);
+   CHECK(view.get<unsigned int>(1) == 1);
+   CHECK(view.get<unsigned int>(3) == 3);
+   CHECK(view.get<std::string>(4) == "0123456789");
+   CHECK(view.get<double>(5) == 2.5);
+   CHECK(view.get<bool>(6));
+   long l = 0;
+   view.get(2, l);
+   CHECK(l == 2);
+   CHECK(view.data(4) == v.data() + 14);
+   CHECK_THROWS_AS(view.get<int>(7), std::out_of_range);
+
+   typedef STRUC_FIXED("<h3I10sd?") F;
+   F::view fview(v.data());
+   CHECK(fview.get<0>() == -5);
+   CHECK(fview.get<3>() == 3);
+   CHECK(fview.get<4>() == "0123456789");
+   CHECK(fview.get<5>() == 2.5);
+   CHECK(fview.get<6>());
+   CHECK(fview.data<4>() == v.data() + 14);
+}
+
+TEST_CASE("Patch single fields", "[struc]")
+{
+   std::string pattern("!IQ4sd");
+   struc s(pattern);
+   auto v = struc::pack(pattern, 1, 1000, "abcd", 0.5);
+   s.pack_field(v.data(), 0, 2);
+   s.pack_field(v.data(), 1, 2000ULL);
+   s.pack_field(v.data(), 2, std::string("efgh"));
+   CHECK_THROWS_AS(s.pack_field(v.data(), 2, "toolong"), std::logic_error);
+   CHECK_THROWS_AS(s.pack_field(v.data(), 4, 1), std::out_of_range);
+   CHECK(v == struc::pack(pattern, 2, 2000, "efgh", 0.5));
+   unsigned long long Q;
+   s.unpack_field(v.data(), 1, Q);
+   CHECK(Q == 2000);
+
+   typedef STRUC_FIXED("!IQ4sd") F;
+   F::pack_field<0>(v.data(), 3);
+   F::pack_field<3>(v.data(), -1.0);
+   CHECK(v == struc::pack(pattern, 3, 2000, "efgh", -1.0));
+   double d;
+   F::unpack_field<3>(v.data(), d);
+   CHECK(d == -1.0);
+}
+
+TEST_CASE("Pack into and unpack from offsets", "[struc]")
+{
+   struc s("<hI");
+   std::vector<char> v(3 * s.calcsize() + 1, '\0');
+   size_t offset = 1;
+   for (int n = 0; n < 3; ++n)
+   {
+      offset = s.pack_into(v.data(), v.size(), offset, n, 100 * n);
+   }
+   CHECK(offset == v.size());
+   CHECK_THROWS_AS(s.pack_into(v.data(), v.size(), offset, 1, 1),
+                   std::out_of_range);
+   CHECK_THROWS_AS(s.pack_into(v.data(), v.size(), v.size() + 1, 1, 1),
+                   std::out_of_range);
+   std::tuple<short, unsigned int> t;
+   offset = struc::unpack_from(std::string("<hI"), v.data(), v.size(), 7, t);
+   CHECK(offset == 13);
+   CHECK(std::get<0>(t) == 1);
+   CHECK(std::get<1>(t) == 100);
+   short h;
+   unsigned int I;
+   s.unpack_from(v.data(), v.size(), 13, h, I);
+   CHECK(h == 2);
+   CHECK(I == 200);
+   CHECK_THROWS_AS(s.unpack_from(v.data(), v.size() - 1, 13, h, I),
+                   std::out_of_range);
+}
+
+TEST_CASE("Non-throwing API", "[struc]")
+{
+   struc s("<hI3s");
+   std::vector<char> v(s.calcsize(), '\0');
+   auto st = s.try_pack(v.data(), 1, 2, "abc");
+   CHECK(st.code == struc::errc());
+   CHECK(!st.error());
+   CHECK(v == struc::pack(std::string("<hI3s"), 1, 2, "abc"));
+
+   std::unique_ptr<struc> c;
+   CHECK(struc::try_compile("<3hz", c).code == struc::errc::illegal_type);
+   CHECK(!c);
+   CHECK_THROWS_AS(struc("<3hz"), std::logic_error);
+   CHECK(struc::try_compile("<3h", c).code == struc::errc());
+   CHECK(c->calcsize() == 6);
+
+   st = s.try_pack(v.data(), 1, 2, "abc", 4);
+   CHECK(st.code == struc::errc::extra_arguments);
+   CHECK(st.error() == struc::errc::extra_arguments);
+   CHECK(st.index == 3);
+   st = s.try_pack(v.data(), 1);
+   CHECK(st.code == struc::errc::missing_arguments);
+   CHECK(st.index == 1);
+   st = s.try_pack(v.data(), 1, 2, "ab");
+   CHECK(st.code == struc::errc::wrong_string_length);
+   CHECK(st.index == 2);
+   CHECK(st.expected == 3);
+   CHECK(st.actual == 2);
+   st = s.try_pack(v.data(), 1, 2, 3);
+   CHECK(st.code == struc::errc::illegal_type);
+   CHECK(st.index == 2);
+   CHECK(std::string(st.error().category().name()) == "struc");
+
+   short h;
+   unsigned int I;
+   std::string str;
+   st = s.try_unpack(v.data(), h, I, str);
+   CHECK(st.code == struc::errc());
+   CHECK(h == 1);
+   CHECK(I == 2);
+   CHECK(str == "abc");
+   st = s.try_unpack_from(v.data(), v.size(), 1, h, I, str);
+   CHECK(st.code == struc::errc::buffer_too_small);
+   CHECK(st.expected == v.size() + 1);
+   st = s.try_unpack_field(v.data(), 3, h);
+   CHECK(st.code == struc::errc::index_out_of_range);
+
+   struc a("3i");
+   int arr[2];
+   st = a.try_unpack(std::vector<char>(a.calcsize()).data(), arr);
+   CHECK(st.code == struc::errc::array_too_small);
+   CHECK(st.expected == 3);
+   CHECK(st.actual == 2);
+   CHECK_THROWS_AS(a.unpack(std::vector<char>(a.calcsize()).data(), arr),
+                   std::underflow_error);
+}
+
+TEST_CASE("Iterate over records", "[struc]")
+{
+   struc s("!hI");
+   CHECK(s.stride() == s.calcsize());
+   std::vector<char> v(4 * s.stride());
+   for (int n = 0; n < 4; ++n)
+   {
+      s.pack_into(v.data(), v.size(), n * s.stride(), n, 10 * n);
+   }
+   int n = 0;
+   for (const auto& r : s.iter_unpack(v.data(), v.size()))
+   {
+      short h;
+      unsigned int I;
+      r.unpack(h, I);
+      CHECK(h == n);
+      CHECK(I == 10u * n);
+      ++n;
+   }
+   CHECK(n == 4);
+   auto records = s.iter_unpack(v.data(), v.size());
+   CHECK(records.size() == 4);
+   CHECK(records[2].get<int>(1) == 20);
+   CHECK(records.end() - records.begin() == 4);
+   std::reverse_iterator<decltype(records.begin())> last(records.end());
+   CHECK(last->get<int>(1) == 30);
+   CHECK((*++last).get<int>(0) == 2);
+   CHECK_THROWS_AS(s.iter_unpack(v.data(), v.size() - 1), std::out_of_range);
+   CHECK(s.iter_unpack(v.data(), 0).empty());
+
+   struc a("@ic");
+   CHECK(a.calcsize() == sizeof(int) + 1);
+   CHECK(a.stride() == 2 * sizeof(int));
+   std::vector<char> w(2 * a.stride() + a.calcsize());
+   CHECK(a.iter_unpack(w.data(), w.size()).size() == 3);
+
+   typedef STRUC_FIXED("ic") F;
+   static_assert(F::stride() == 2 * sizeof(int), "wrong stride");
+   F::pack(w.data() + F::stride(), 7, 'x');
+   auto fr = F::iter_unpack(w.data(), w.size());
+   CHECK(fr.size() == 3);
+   CHECK(fr[1].get<0>() == 7);
+   CHECK((fr.begin() + 1)->get<1>() == 'x');
+   std::tuple<int, char> t;
+   (++fr.begin())->unpack(t);
+   CHECK(std::get<0>(t) == 7);
+}
+
+TEST_CASE("Pack many records", "[struc]")
+{
+   std::vector<std::tuple<int, double>> records;
+   for (int n = 0; n < 5; ++n)
+   {
+      records.emplace_back(n, n / 2.0);
+   }
+   std::string pattern("<id");
+   auto v = struc::pack_many(pattern, records.begin(), records.end());
+   CHECK(v.size() == 5 * struc::calcsize(pattern));
+   std::vector<char> expected;
+   for (const auto& r : records)
+   {
+      auto p = struc::pack(pattern, r);
+      expected.insert(expected.end(), p.begin(), p.end());
+   }
+   CHECK(v == expected);
+
+   struct point
+   {
+      short x;
+      short y;
+   };
+   std::vector<point> points = {{1, 2}, {3, 4}, {5, 6}};
+   struc s("hhi");
+   CHECK(s.stride() == 8);
+   std::vector<char> w(points.size() * s.stride());
+   auto n = s.pack_many(w.data(), points.begin(), points.end(),
+                        [](const point& p) {
+                           return std::make_tuple(p.x, p.y, p.x * p.y);
+                        });
+   CHECK(n == w.size());
+   int i = 0;
+   for (const auto& r : s.iter_unpack(w.data(), w.size()))
+   {
+      CHECK(r.get<short>(0) == points[i].x);
+      CHECK(r.get<int>(2) == points[i].x * points[i].y);
+      ++i;
+   }
+   std::vector<int> single = {7, 8};
+   CHECK(struc("!I").pack_many(single.begin(), single.end())
+         == struc::pack(std::string("!II"), 7, 8));
+   auto mapped = s.pack_many(points.begin(), points.end(), [](const point& p) {
+      return std::make_tuple(p.x, p.y, p.x * p.y);
+   });
+   CHECK(mapped == w);
+   CHECK(struc::pack_many(std::string("hhi"),
+                          points.begin(),
+                          points.end(),
+                          [](const point& p) {
+                             return std::make_tuple(p.x, p.y, p.x * p.y);
+                          })
+         == mapped);
+   std::istringstream in("7 8 9");
+   auto streamed = struc("!I").pack_many(std::istream_iterator<int>(in),
+                                         std::istream_iterator<int>());
+   CHECK(streamed == struc::pack(std::string("!III"), 7, 8, 9));
+}
+
+TEST_CASE("Unpack columns", "[struc]")
+{
+   struc s(">hId2s");
+   std::vector<char> v(4 * s.stride());
+   for (int n = 0; n < 4; ++n)
+   {
+      s.pack_into(v.data(), v.size(), n * s.stride(), -n, 1000 * n, n / 4.0,
+                  std::string(2, static_cast<char>('a' + n)));
+   }
+   std::vector<int16_t> h;
+   std::vector<uint32_t> I;
+   double d[4];
+   std::vector<std::string> str;
+   s.unpack_columns(v.data(), 4, h, I, d, str);
+   REQUIRE(h.size() == 4);
+   for (int n = 0; n < 4; ++n)
+   {
+      CHECK(h[n] == -n);
+      CHECK(I[n] == 1000u * n);
+      CHECK(d[n] == n / 4.0);
+      CHECK(str[n] == std::string(2, static_cast<char>('a' + n)));
+   }
+
+   struc a("=b3i");
+   std::vector<char> w(3 * a.stride());
+   a.pack(w.data() + a.stride(), 1, 2, 3, 4);
+   std::vector<int> b, i0, i1, i2;
+   a.unpack_columns(w.data(), 3, b, i0, i1, i2);
+   CHECK(b[1] == 1);
+   CHECK(i2[1] == 4);
+   CHECK(i0[2] == 0);
+
+   CHECK_THROWS_AS(a.unpack_columns(w.data(), 3, b, i0, i1),
+                   std::underflow_error);
+   auto st = a.try_unpack_columns(w.data(), 3, b, i0, i1, i2, h);
+   CHECK(st.code == struc::errc::extra_arguments);
+   CHECK(st.index == 4);
+}
+
+TEST_CASE("Pack columns", "[struc]")
+{
+   struc s("<hId2s");
+   std::vector<short> h = {1, -2, 3};
+   unsigned int I[] = {10, 20, 30};
+   std::vector<double> d = {0.5, 1.5, -2.5};
+   std::vector<std::string> str = {"ab", "cd", "ef"};
+   std::vector<char> v(3 * s.stride());
+   s.pack_columns(v.data(), 3, h, I, d, str);
+   std::vector<char> expected;
+   for (int n = 0; n < 3; ++n)
+   {
+      auto r = struc::pack(std::string("<hId2s"), h[n], I[n], d[n], str[n]);
+      expected.insert(expected.end(), r.begin(), r.end());
+   }
+   CHECK(v == expected);
+
+   struc n("@ci");
+   std::vector<char> c = {'x', 'y'};
+   std::vector<int> i = {7, 8};
+   std::vector<char> w(2 * n.stride());
+   n.pack_columns(w.data(), 2, c.data(), i.data());
+   std::vector<char> c2;
+   std::vector<int> i2;
+   n.unpack_columns(w.data(), 2, c2, i2);
+   CHECK(c2 == c);
+   CHECK(i2 == i);
+
+   auto st = n.try_pack_columns(w.data(), 3, c, i);
+   CHECK(st.code == struc::errc::array_too_small);
+   CHECK(st.index == 0);
+   str[1] = "toolong";
+   CHECK_THROWS_AS(s.pack_columns(v.data(), 3, h, I, d, str),
+                   std::logic_error);
+}
+
+template <typename T, size_t N>
+void check_array_run(const std::string& type)
+{
+   for (auto order : {"<", ">", "!", "="})
+   {
+      T a[N];
+      for (size_t i = 0; i < N; ++i)
+      {
+         a[i] = static_cast<T>(i * 0x01020304u + 0x8090);
+      }
+      struc s(order + std::to_string(N) + type);
+      std::vector<char> v(s.calcsize());
+      s.pack(v.data(), a);
+      struc e(order + type);
+      for (size_t i = 0; i < N; ++i)
+      {
+         T t;
+         e.unpack(v.data() + i * e.calcsize(), t);
+         CHECK(t == a[i]);
+      }
+      T b[N];
+      s.unpack(v.data(), b);
+      CHECK(std::equal(a, a + N, b));
+   }
+}
+
+TEST_CASE("Arrays of byte swapped items", "[struc]")
+{
+   check_array_run<int16_t, 1>("h");
+   check_array_run<uint16_t, 31>("H");
+   check_array_run<int32_t, 4>("i");
+   check_array_run<uint32_t, 37>("I");
+   check_array_run<int64_t, 2>("q");
+   check_array_run<uint64_t, 19>("Q");
+   check_array_run<float, 23>("f");
+   check_array_run<double, 9>("d");
+}
+
+TEST_CASE("Byte swap kernels", "[struc]")
+{
+   auto tables = struc::swap_kernel_tables();
+   REQUIRE(!tables.empty());
+   for (size_t size = 2; size <= 8; size *= 2)
+   {
+      for (size_t n = 0; n <= 33; ++n)
+      {
+         // offset by one byte to run the kernels on unaligned items
+         std::vector<char> v(1 + n * size);
+         for (size_t i = 0; i < v.size(); ++i)
+         {
+            v[i] = static_cast<char>(i * 7 + size);
+         }
+         std::vector<char> expected(v);
+         for (size_t i = 0; i < n; ++i)
+         {
+            auto item = expected.begin() + 1 + i * size;
+            std::reverse(item, item + size);
+         }
+         for (auto table : tables)
+         {
+            auto w = v;
+            table[size / 4](w.data() + 1, n);
+            CHECK(w == expected);
+         }
+      }
+   }
+}
+
+TEST_CASE("Runs from containers and spans", "[struc]")
+{
+   std::string pattern(">h4I3d");
+   std::array<uint32_t, 4> a = {{1, 2, 3, 4}};
+   std::vector<double> d = {0.5, 1.5, 2.5};
+   auto v = struc::pack(pattern, 7, a, d);
+   CHECK(v == struc::pack(pattern, 7, 1, 2, 3, 4, 0.5, 1.5, 2.5));
+
+   short h;
+   std::vector<uint32_t> a2;
+   double d2[3];
+   auto span = struc::make_span(d2, 3);
+   struc::unpack(pattern, v.data(), h, a2, span);
+   CHECK(h == 7);
+   CHECK(a2 == std::vector<uint32_t>(a.begin(), a.end()));
+   CHECK(std::equal(d.begin(), d.end(), d2));
+
+   std::array<int, 4> i;
+   std::vector<float> f;
+   struc::unpack(std::string("<h4I3d"), v.data(), h, i, f);
+   CHECK(f.size() == 3);
+
+   const uint32_t raw[] = {9, 8, 7, 6};
+   CHECK(struc::pack(pattern, 7, struc::make_span(raw, 4), d)
+         == struc::pack(pattern, 7, 9, 8, 7, 6, 0.5, 1.5, 2.5));
+   d.push_back(3.5);
+   CHECK_THROWS_AS(struc::pack(pattern, 7, a, d), std::overflow_error);
+   CHECK_THROWS_AS(struc::pack(pattern, 7, struc::make_span(raw, 3), d),
+                   std::underflow_error);
+}
+
+struct inline_executor
+{
+   size_t concurrency() const
+   {
+      return 3;
+   }
+
+   void operator()(size_t chunks,
+                   const std::function<void(size_t)>& task) const
+   {
+      for (size_t k = chunks; k-- > 0;)
+      {
+         task(k);
+      }
+   }
+};
+
+TEST_CASE("Parallel batches", "[struc]")
+{
+   struc s("<iHd");
+   const size_t n = 1001;
+   typedef std::tuple<int, unsigned short, double> record;
+   std::vector<record> records;
+   for (size_t k = 0; k < n; ++k)
+   {
+      records.emplace_back(-static_cast<int>(k), k % 7, k / 8.0);
+   }
+   auto expected = s.pack_many(records.begin(), records.end());
+   std::vector<char> v(n * s.stride());
+   CHECK(s.pack_many_parallel(struc::thread_executor(4), v.data(),
+                              records.begin(), records.end())
+         == v.size());
+   CHECK(v == expected);
+
+   std::vector<char> w(n * s.stride());
+   s.pack_many_parallel(inline_executor(),
+                        w.data(),
+                        records.begin(),
+                        records.end(),
+                        [](const record& r) { return r; });
+   CHECK(w == expected);
+
+   std::vector<record> out(n);
+   s.unpack_many_parallel(struc::thread_executor(), v.data(), n, out.begin());
+   CHECK(out == records);
+   std::fill(out.begin(), out.end(), std::make_tuple(0, 0, 0.0));
+   s.unpack_many(v.data(), n, out.begin());
+   CHECK(out == records);
+
+   std::vector<int> i;
+   std::vector<unsigned short> H;
+   std::vector<double> d;
+   s.unpack_columns_parallel(struc::thread_executor(5), v.data(), n, i, H, d);
+   REQUIRE(i.size() == n);
+   CHECK(i[500] == -500);
+   CHECK(H[500] == 500 % 7);
+   CHECK(d[1000] == 125.0);
+
+   std::vector<char> x(n * s.stride());
+   s.pack_columns_parallel(inline_executor(), x.data(), n, i, H.data(), d);
+   CHECK(x == expected);
+   H.pop_back();
+   CHECK_THROWS_AS(
+      s.pack_columns_parallel(inline_executor(), x.data(), n, i, H, d),
+      std::underflow_error);
+   CHECK_THROWS_AS(s.pack_many_parallel(struc::thread_executor(4),
+                                        w.data(),
+                                        records.begin(),
+                                        records.end(),
+                                        [](const record& r) {
+                                           if (std::get<0>(r) == -700)
+                                           {
+                                              throw std::runtime_error("700");
+                                           }
+                                           return r;
+                                        }),
+                   std::runtime_error);
+}
+
+TEST_CASE("Scan records", "[struc]")
+{
+   struc s(">Ih3sd");
+   const size_t n = 2500;
+   std::vector<char> v(n * s.stride());
+   for (size_t k = 0; k < n; ++k)
+   {
+      s.pack_into(v.data(), v.size(), k * s.stride(), k % 10, -short(k % 100),
+                  k % 2 ? "odd" : "evn", k / 10.0);
+   }
+   auto found = s.scan(v.data(), n, struc::where(0u, struc::compare::eq, 3u),
+                       struc::where(1, struc::compare::le, short(-50)));
+   std::vector<size_t> expected;
+   for (size_t k = 0; k < n; ++k)
+   {
+      if (k % 10 == 3 && k % 100 >= 50)
+      {
+         expected.push_back(k);
+      }
+   }
+   CHECK(found == expected);
+   CHECK(found == s.scan_if(v.data(), n, [](const struc::view& r) {
+      return r.get<unsigned>(0) == 3 && r.get<short>(1) <= -50;
+   }));
+
+   auto even = s.scan(v.data(), n,
+                      struc::where(2, struc::compare::ne, std::string("odd")),
+                      struc::where(3, struc::compare::gt, 200.0));
+   CHECK(even.size() == 249);
+   CHECK(even.front() == 2002);
+   CHECK(s.scan(v.data(), n).size() == n);
+   CHECK_THROWS_AS(s.scan(v.data(), n, struc::where(4, struc::compare::eq, 1)),
+                   std::out_of_range);
+}
+
+TEST_CASE("Aggregate items", "[struc]")
+{
+   struc s("<qHd");
+   const size_t n = 3000;
+   std::vector<char> v(n * s.stride());
+   for (size_t k = 0; k < n; ++k)
+   {
+      s.pack_into(v.data(), v.size(), k * s.stride(),
+                  static_cast<long long>(k) - 1000, k % 50, k * 0.5);
+   }
+   auto q = s.summarize<long long>(v.data(), n, 0);
+   CHECK(q.count == n);
+   CHECK(q.sum == 1500LL * 2999 - 1000LL * 3000);
+   CHECK(q.min == -1000);
+   CHECK(q.max == 1999);
+   CHECK(q.mean() == Approx(499.5));
+   auto p = s.summarize_parallel<long long>(
+      struc::thread_executor(3), v.data(), n, 0);
+   CHECK(p.sum == q.sum);
+   CHECK(p.min == q.min);
+   CHECK(p.max == q.max);
+
+   auto H = s.summarize<unsigned>(v.data(), n, 1);
+   CHECK(H.max == 49);
+   CHECK(H.min == 0);
+   auto d = s.summarize<double>(v.data(), 0, 2);
+   CHECK(d.count == 0);
+   CHECK(std::isnan(d.mean()));
+
+   // the sum is wider than the items
+   struc narrow("<h");
+   std::vector<char> w(1000 * narrow.stride());
+   for (size_t k = 0; k < 1000; ++k)
+   {
+      narrow.pack_into(w.data(), w.size(), k * narrow.stride(), 30000);
+   }
+   auto wide = narrow.summarize<short>(w.data(), 1000, 0);
+   CHECK(wide.sum == 30000000);
+   CHECK(wide.mean() == Approx(30000.0));
+   CHECK(narrow.summarize_parallel<short>(
+            struc::thread_executor(3), w.data(), 1000, 0).sum
+         == 30000000);
+
+   auto odd = [](unsigned h) { return h % 2 == 1; };
+   CHECK(s.count_if<unsigned>(v.data(), n, 1, odd) == n / 2);
+   CHECK(s.count_if_parallel<unsigned>(
+            struc::thread_executor(4), v.data(), n, 1, odd)
+         == n / 2);
+
+   auto h = s.histogram<double>(v.data(), n, 2, 0.0, 1000.0, 4);
+   CHECK(h == std::vector<size_t>({500, 500, 500, 500}));
+   CHECK(s.histogram_parallel<double>(
+            struc::thread_executor(2), v.data(), n, 2, 0.0, 1000.0, 4)
+         == h);
+   CHECK_THROWS_AS(s.summarize<int>(v.data(), n, 3), std::out_of_range);
+   CHECK_THROWS_AS(s.histogram<double>(v.data(), n, 2, 0.0, 1.0, 0),
+                   std::invalid_argument);
+   CHECK_THROWS_AS(s.histogram<double>(v.data(), n, 2, 1.0, 1.0, 4),
+                   std::invalid_argument);
+   CHECK_THROWS_AS(s.histogram_parallel<double>(
+                      struc::thread_executor(2), v.data(), n, 2, 2.0, 1.0, 4),
+                   std::invalid_argument);
+}
+
+template <typename T>
+void check_sort(const std::string& fmt, const std::vector<T>& keys)
+{
+   struc s(fmt);
+   std::vector<char> v(keys.size() * s.stride());
+   for (size_t k = 0; k < keys.size(); ++k)
+   {
+      s.pack_into(
+         v.data(), v.size(), k * s.stride(), static_cast<unsigned>(k), keys[k]);
+   }
+   auto order = s.sort_index(v.data(), keys.size(), 1);
+   std::vector<size_t> expected(keys.size());
+   for (size_t k = 0; k < expected.size(); ++k)
+   {
+      expected[k] = k;
+   }
+   std::stable_sort(expected.begin(),
+                    expected.end(),
+                    [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+   CHECK(order == expected);
+
+   s.sort_records(v.data(), keys.size(), 1);
+   for (size_t k = 0; k < keys.size(); ++k)
+   {
+      unsigned i;
+      T t;
+      s.unpack_from(v.data(), v.size(), k * s.stride(), i, t);
+      CHECK(i == expected[k]);
+      CHECK(t == keys[expected[k]]);
+   }
+}
+
+TEST_CASE("Sort records", "[struc]")
+{
+   std::vector<long long> q;
+   std::vector<double> d;
+   std::vector<short> h;
+   std::vector<unsigned> u;
+   for (int k = 0; k < 500; ++k)
+   {
+      q.push_back((k * 7919LL) % 1001 - 500);
+      d.push_back(((k * 31) % 97 - 48) * 0.25);
+      h.push_back(static_cast<short>((k * 37) % 200 - 100));
+      u.push_back(static_cast<unsigned>(k * 2654435761U));
+   }
+   check_sort("Iq", q);
+   check_sort(">Iq", q);
+   check_sort("<Id", d);
+   check_sort("!Id", d);
+   check_sort("=Ih", h);
+   check_sort(">II", u);
+   check_sort("<II", std::vector<unsigned>());
+
+   struc s("<I3s");
+   std::vector<char> v(s.stride());
+   CHECK_THROWS_AS(s.sort_records(v.data(), 1, 1), std::logic_error);
+   CHECK_THROWS_AS(s.sort_index(v.data(), 1, 2), std::out_of_range);
+}
+
+TEST_CASE("Memory mapped records", "[struc]")
+{
+   struc s("<qIHd");
+   const size_t n = 1000;
+   std::vector<char> v(4 + n * s.stride());
+   memcpy(v.data(), "HDR1", 4);
+   for (size_t k = 0; k < n; ++k)
+   {
+      s.pack_into(v.data(), v.size(), 4 + k * s.stride(),
+                  static_cast<long long>(k) * 1000, k, k % 7, k * 0.5);
+   }
+   char path[] = "/tmp/struc_mapped_XXXXXX";
+   int fd = mkstemp(path);
+   REQUIRE(fd >= 0);
+   REQUIRE(write(fd, v.data(), v.size()) == static_cast<ssize_t>(v.size()));
+   close(fd);
+
+   struc::mapped_file f(s, path, 4);
+   CHECK(f.size() == n);
+   CHECK(std::string(f.header(), 4) == "HDR1");
+   CHECK(f.header_size() == 4);
+   CHECK(f[999].get<long long>(0) == 999000);
+   CHECK(f.at(500).get<double>(3) == 250.0);
+   CHECK_THROWS_AS(f.at(n), std::out_of_range);
+
+   f.advise(struc::mapped_file::advice::sequential);
+   f.advise(struc::mapped_file::advice::willneed, 100, 10);
+   unsigned sum = 0;
+   for (const auto& r : f)
+   {
+      sum += r.get<unsigned>(1);
+   }
+   CHECK(sum == n * (n - 1) / 2);
+   CHECK(f.end() - f.begin() == static_cast<std::ptrdiff_t>(n));
+
+   struc q("<q");
+   struc::mapped_file g(q, path, v.size());
+   CHECK(g.empty());
+   CHECK_THROWS_AS(struc::mapped_file(s, path), std::out_of_range);
+   CHECK_THROWS_AS(struc::mapped_file(s, path, v.size() + 1),
+                   std::out_of_range);
+   unlink(path);
+   CHECK_THROWS_AS(struc::mapped_file(s, path), std::system_error);
+}
+
+TEST_CASE("Read streams of records", "[struc]")
+{
+   struc s("qH");
+   const size_t n = 100;
+   std::vector<char> v(n * s.stride() - (s.stride() - s.calcsize()));
+   for (size_t k = 0; k < n; ++k)
+   {
+      s.pack_into(
+         v.data(), v.size(), k * s.stride(), static_cast<long long>(k), k);
+   }
+
+   // chunks that split records
+   std::istringstream is(std::string(v.data(), v.size()));
+   struc::reader r(s, is, 37);
+   size_t k = 0;
+   for (const auto& rec : r)
+   {
+      CHECK(rec.get<long long>(0) == static_cast<long long>(k));
+      CHECK(rec.get<unsigned>(1) == k);
+      ++k;
+   }
+   CHECK(k == n);
+
+   int fds[2];
+   REQUIRE(pipe(fds) == 0);
+   bool written = true;
+   std::thread t([&]() {
+      // small writes, so the reader sees short reads
+      for (size_t i = 0; i < v.size(); i += 7)
+      {
+         size_t m = std::min<size_t>(7, v.size() - i);
+         written &= write(fds[1], v.data() + i, m) == static_cast<ssize_t>(m);
+      }
+      close(fds[1]);
+   });
+   struc::reader f(s, fds[0]);
+   long long sum = 0;
+   CHECK(f.for_each(
+            [&](const struc::view& rec) { sum += rec.get<long long>(0); })
+         == n);
+   CHECK(sum == static_cast<long long>(n * (n - 1) / 2));
+   t.join();
+   CHECK(written);
+   close(fds[0]);
+
+   std::istringstream partial(std::string(v.data(), s.stride() + 3));
+   struc::reader p(s, partial);
+   struc::view rec(s, nullptr);
+   CHECK(p.next(rec));
+   CHECK_THROWS_AS(p.next(rec), std::out_of_range);
+
+   struc empty("<0s");
+   CHECK_THROWS_AS(struc::reader(empty, partial), std::out_of_range);
+}
+
+TEST_CASE("Write records in batches", "[struc]")
+{
+   struc s("qH");
+   char path[] = "/tmp/struc_writer_XXXXXX";
+   int fd = mkstemp(path);
+   REQUIRE(fd >= 0);
+   const size_t n = 1000;
+   std::string payload(300, 'p');
+   {
+      struc::writer w(s, fd, 100, struc::writer::sync_policy::every_flush);
+      w.write_bytes("HDR1", 4);
+      w.write(std::make_tuple(-1LL, 0));
+      CHECK(w.buffered() == 4 + s.stride());
+      // larger than the buffer, written along with it
+      w.write_bytes(payload.data(), payload.size());
+      CHECK(w.buffered() == 0);
+      for (size_t k = 0; k < n; ++k)
+      {
+         w.write(static_cast<long long>(k), k);
+      }
+      CHECK_THROWS_AS(w.write(1LL), std::underflow_error);
+      w.flush();
+      CHECK(w.buffered() == 0);
+      w.write(1LL, 1);
+   }
+   close(fd);
+
+   std::vector<char> v(4 + s.stride() + payload.size() + (n + 1) * s.stride());
+   FILE* f = fopen(path, "rb");
+   REQUIRE(f);
+   CHECK(fread(v.data(), 1, v.size() + 1, f) == v.size());
+   fclose(f);
+   unlink(path);
+
+   CHECK(std::string(v.data(), 4) == "HDR1");
+   CHECK(struc::view(s, v.data() + 4).get<long long>(0) == -1);
+   const char* records = v.data() + 4 + s.stride() + payload.size();
+   CHECK(std::string(records - payload.size(), payload.size()) == payload);
+   auto r = s.iter_unpack(records, (n + 1) * s.stride());
+   for (size_t k = 0; k < n; ++k)
+   {
+      CHECK(r[k].get<unsigned>(1) == k);
+   }
+   CHECK(r[n].get<long long>(0) == 1);
+
+   struc::writer bad(s, -1);
+   bad.write(1LL, 1);
+   CHECK_THROWS_AS(bad.flush(), std::system_error);
+}
+
+TEST_CASE("Write records asynchronously", "[struc]")
+{
+   struc s("qH");
+   const size_t n = 20000;
+   int fds[2];
+   REQUIRE(pipe(fds) == 0);
+   size_t read = 0;
+   bool ordered = true;
+   std::thread t([&]() {
+      // start late, so the pipe fills up and the writer has to wait
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      struc::reader r(s, fds[0]);
+      r.for_each([&](const struc::view& rec) {
+         ordered &= rec.get<long long>(0) == static_cast<long long>(read);
+         ++read;
+      });
+   });
+   {
+      struc::async_writer w(s, fds[1], 4096, 3);
+      for (size_t k = 0; k < n; ++k)
+      {
+         w.write(static_cast<long long>(k), k);
+      }
+      w.flush();
+      CHECK(w.queue_depth() == 0);
+      CHECK(w.stalls() > 0);
+      w.write(std::make_tuple(static_cast<long long>(n), 0));
+   }
+   close(fds[1]);
+   t.join();
+   close(fds[0]);
+   CHECK(read == n + 1);
+   CHECK(ordered);
+
+   struc::async_writer bad(s, -1, 64);
+   bad.write(1LL, 1);
+   CHECK_THROWS_AS(bad.flush(), std::system_error);
+   CHECK_THROWS_AS(bad.flush(), std::system_error);
+}
+
+TEST_CASE("Decode records from fragments", "[struc]")
+{
+   struc s("!qH");
+   const size_t n = 5000;
+   std::vector<char> v(n * s.stride());
+   for (size_t k = 0; k < n; ++k)
+   {
+      s.pack_into(
+         v.data(), v.size(), k * s.stride(), static_cast<long long>(k), k);
+   }
+
+   int fds[2];
+   REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+   bool sent = true;
+   std::thread t([&]() {
+      // fragments of varying size, none of them aligned to records
+      size_t m = 1;
+      for (size_t i = 0; i < v.size(); i += m, m = m % 23 + 1)
+      {
+         m = std::min(m, v.size() - i);
+         sent &= send(fds[0], v.data() + i, m, 0) == static_cast<ssize_t>(m);
+      }
+      close(fds[0]);
+   });
+   size_t decoded = 0;
+   bool ordered = true;
+   struc::decoder d(s, [&](const struc::view& rec) {
+      ordered &= rec.get<long long>(0) == static_cast<long long>(decoded);
+      ordered &= rec.get<unsigned>(1) == decoded % 65536;
+      ++decoded;
+   });
+   char fragment[61];
+   for (ssize_t r; (r = recv(fds[1], fragment, sizeof(fragment), 0)) > 0;)
+   {
+      d.feed(fragment, static_cast<size_t>(r));
+   }
+   t.join();
+   close(fds[1]);
+   CHECK(sent);
+   CHECK(ordered);
+   CHECK(decoded == n);
+   CHECK(d.pending() == 0);
+
+   CHECK(d.feed(v.data(), 3) == 0);
+   CHECK(d.pending() == 3);
+   CHECK(d.feed(v.data() + 3, 2 * s.stride()) == 2);
+   CHECK(d.pending() == 3);
+   d.reset();
+   CHECK(d.pending() == 0);
+
+   struc empty("<0s");
+   CHECK_THROWS_AS(struc::decoder(empty, nullptr), std::out_of_range);
+
+   // records are passed on before their trailing padding arrives
+   struc padded("@qH");
+   REQUIRE(padded.stride() > padded.calcsize());
+   std::vector<char> p(3 * padded.stride());
+   for (size_t k = 0; k < 3; ++k)
+   {
+      padded.pack_into(p.data(), p.size(), k * padded.stride(),
+                       static_cast<long long>(k), k + 10);
+   }
+   std::vector<long long> got;
+   struc::decoder pd(padded, [&](const struc::view& rec) {
+      got.push_back(rec.get<long long>(0));
+   });
+   CHECK(pd.feed(p.data(), padded.calcsize()) == 1);
+   CHECK(pd.pending() == 0);
+   CHECK(pd.feed(p.data() + padded.calcsize(), 1) == 0);
+   // the rest of the padding and part of the second record
+   size_t split = padded.stride() + 7;
+   CHECK(pd.feed(p.data() + padded.calcsize() + 1,
+                 split - padded.calcsize() - 1)
+         == 0);
+   CHECK(pd.pending() == 7);
+   CHECK(pd.feed(p.data() + split,
+                 2 * padded.stride() + padded.calcsize() - split)
+         == 2);
+   CHECK(pd.pending() == 0);
+   CHECK(got == std::vector<long long>({0, 1, 2}));
+}
+
+TEST_CASE("Split a stream into frames", "[struc]")
+{
+   struc h("!HI");
+   auto pack_header = [&](size_t id, size_t length) {
+      std::vector<char> b(h.calcsize());
+      h.pack(b.data(), id, length);
+      return b;
+   };
+   const size_t n = 300;
+   std::vector<char> v;
+   for (size_t k = 0; k < n; ++k)
+   {
+      std::string payload(k * 7 % 500, static_cast<char>('a' + k % 26));
+      auto header = pack_header(k, payload.size());
+      v.insert(v.end(), header.begin(), header.end());
+      v.insert(v.end(), payload.begin(), payload.end());
+   }
+
+   int fds[2];
+   REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+   bool sent = true;
+   std::thread t([&]() {
+      for (size_t i = 0; i < v.size(); i += 1000)
+      {
+         size_t m = std::min<size_t>(1000, v.size() - i);
+         sent &= send(fds[0], v.data() + i, m, 0) == static_cast<ssize_t>(m);
+      }
+      close(fds[0]);
+   });
+   size_t frames = 0;
+   bool valid = true;
+   struc::framer f(
+      h, 1, [&](const struc::view& header, const char* p, size_t length) {
+         valid &= header.get<unsigned>(0) == frames;
+         valid &= length == frames * 7 % 500;
+         valid &= std::count(p, p + length, 'a' + frames % 26)
+                  == static_cast<std::ptrdiff_t>(length);
+         ++frames;
+      },
+      500);
+   for (;;)
+   {
+      size_t space;
+      char* p = f.prepare(space);
+      ssize_t r = recv(fds[1], p, space, 0);
+      if (r <= 0)
+      {
+         break;
+      }
+      f.commit(static_cast<size_t>(r));
+      f.drain();
+   }
+   t.join();
+   close(fds[1]);
+   CHECK(sent);
+   CHECK(valid);
+   CHECK(frames == n);
+   CHECK(f.pending() == 0);
+
+   // back pressure, an undrained buffer has no space left
+   struc::framer small(
+      h, 1, [](const struc::view&, const char*, size_t) {}, 4, false, 12);
+   size_t space;
+   char* p = small.prepare(space);
+   REQUIRE(space == 12);
+   auto header = pack_header(1, 0);
+   memcpy(p, header.data(), 6);
+   memcpy(p + 6, header.data(), 6);
+   small.commit(12);
+   small.prepare(space);
+   CHECK(space == 0);
+   CHECK(small.drain(1) == 1);
+   small.prepare(space);
+   CHECK(space == 6);
+   CHECK(small.pending() == 6);
+
+   header = pack_header(1, 5);
+   memcpy(small.prepare(space), header.data(), 6);
+   small.commit(6);
+   // the frame before the bad one is drained
+   CHECK_THROWS_AS(small.drain(), std::length_error);
+   CHECK(small.pending() == 6);
+   CHECK_THROWS_AS(struc::framer(h, 2, nullptr), std::out_of_range);
+   struc named("!4sId");
+   CHECK_THROWS_AS(struc::framer(named, 0, nullptr), std::logic_error);
+   CHECK_THROWS_AS(struc::framer(named, 2, nullptr), std::logic_error);
+   CHECK_THROWS_AS(
+      struc::framer(h, 1, nullptr, std::numeric_limits<size_t>::max()),
+      std::length_error);
+}
+
+struct string_like
+{
+   operator std::string() const
+   {
+      return "xyz";
+   }
+};
+
+TEST_CASE("Pack into iovecs", "[struc]")
+{
+   struc s("!H5sI3sQ");
+   std::string blob("hello");
+   const char* tail = "end";
+   std::vector<char> expected(s.calcsize());
+   s.pack(expected.data(), 1, blob, 2, tail, 3);
+
+   std::vector<char> scratch(s.calcsize());
+   std::vector<iovec> iov;
+   s.pack_iov(iov, scratch.data(), 1, blob, 2, tail, 3);
+   REQUIRE(iov.size() == 5);
+   CHECK(iov[1].iov_base == blob.data());
+   CHECK(iov[3].iov_base == tail);
+   std::string gathered;
+   for (const auto& v : iov)
+   {
+      gathered.append(static_cast<const char*>(v.iov_base), v.iov_len);
+   }
+   CHECK(gathered == std::string(expected.data(), expected.size()));
+
+   // strings at either end, and arrays of char, are handled too
+   struc t("<3sH2s");
+   std::vector<char> packed(t.calcsize());
+   t.pack(packed.data(), "abc", 7, std::string("de"));
+   t.pack_iov(iov, scratch.data(), "abc", 7, std::string("de"));
+   CHECK(iov.size() == 2);
+   gathered.clear();
+   for (const auto& v : iov)
+   {
+      gathered.append(static_cast<const char*>(v.iov_base), v.iov_len);
+   }
+   CHECK(gathered == std::string(packed.data(), packed.size()));
+
+   int fds[2];
+   REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+   s.pack_iov(iov, scratch.data(), 1, blob, 2, tail, 3);
+   CHECK(writev(fds[0], iov.data(), static_cast<int>(iov.size()))
+         == static_cast<ssize_t>(s.calcsize()));
+   std::vector<char> received(s.calcsize());
+   CHECK(recv(fds[1], received.data(), received.size(), MSG_WAITALL)
+         == static_cast<ssize_t>(received.size()));
+   CHECK(received == expected);
+   close(fds[0]);
+   close(fds[1]);
+
+   auto st = s.try_pack_iov(
+      iov, scratch.data(), 1, std::string("hi"), 2, tail, 3);
+   CHECK(st.code == struc::errc::wrong_string_length);
+   CHECK(st.index == 1);
+   CHECK_THROWS_AS(s.pack_iov(iov, scratch.data(), blob, blob, 2, tail, 3),
+                   std::logic_error);
+   CHECK(iov.empty());
+
+   // types that only convert to std::string are copied through one
+   s.pack(scratch.data(), 1, blob, 2, string_like(), 3);
+   CHECK(std::string(scratch.data() + 11, 3) == "xyz");
+   CHECK(s.try_pack_iov(iov, scratch.data(), 1, blob, 2, string_like(), 3)
+            .code
+         == struc::errc());
+   CHECK(iov.size() == 3);
+}
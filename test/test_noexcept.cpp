@@ -0,0 +1,80 @@
+/*
+    struc, A C++11 implementation of python's struct module.
+
+    struc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Copyright (c) 2018, emJay Software Consulting AB, See AUTHORS for details.
+*/
+
+// Built with exceptions disabled, so it can't use catch
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include "struc.hpp"
+
+static int failures = 0;
+
+#define CHECK(x)                                                               \
+   do                                                                          \
+   {                                                                           \
+      if (!(x))                                                                \
+      {                                                                        \
+         std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #x);     \
+         ++failures;                                                           \
+      }                                                                        \
+   } while (false)
+
+int main()
+{
+   struc s("!hId");
+   std::vector<char> v(s.calcsize(), '\0');
+   CHECK(s.try_pack(v.data(), -2, 70000, 1.5).code == struc::errc());
+   short h;
+   unsigned int I;
+   double d;
+   CHECK(s.try_unpack(v.data(), h, I, d).code == struc::errc());
+   CHECK(h == -2);
+   CHECK(I == 70000);
+   CHECK(d == 1.5);
+
+   auto st = s.try_pack(v.data(), 1, 2);
+   CHECK(st.error() == struc::errc::missing_arguments);
+   CHECK(st.index == 2);
+   st = s.try_pack_into(v.data(), v.size(), 1, 1, 2, 3.0);
+   CHECK(st.error() == struc::errc::buffer_too_small);
+   st = s.try_unpack_field(v.data(), 2, d);
+   CHECK(st.code == struc::errc());
+   CHECK(d == 1.5);
+
+   std::unique_ptr<struc> c;
+   st = struc::try_compile("<hy", c);
+   CHECK(st.error() == struc::errc::illegal_type);
+   CHECK(st.index == 1);
+   CHECK(!c);
+   st = struc::try_compile(">P", c);
+   CHECK(st.error() == struc::errc::illegal_type);
+   CHECK(struc::try_compile("<2hd", c).code == struc::errc());
+   CHECK(c && c->calcsize() == 12);
+
+   typedef STRUC_FIXED("<iq") F;
+   std::array<char, F::calcsize()> a = {};
+   F::pack(a.data(), 1, 2);
+   int i;
+   long long q;
+   F::unpack(a.data(), i, q);
+   CHECK(i == 1);
+   CHECK(q == 2);
+   return failures == 0 ? 0 : 1;
+}